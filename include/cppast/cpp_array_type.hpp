@@ -38,7 +38,7 @@ public:
 
 private:
     cpp_array_type(std::unique_ptr<cpp_type> type, std::unique_ptr<cpp_expression> size)
-    : type_(std::move(type)), size_(std::move(size))
+    : type_(type.release()), size_(std::move(size))
     {}
 
     cpp_type_kind do_get_kind() const noexcept override
@@ -46,8 +46,10 @@ private:
         return cpp_type_kind::array_t;
     }
 
-    std::unique_ptr<cpp_type>       type_;
+    detail::cpp_type_ptr            type_;
     std::unique_ptr<cpp_expression> size_;
+
+    friend cpp_type_context;
 };
 } // namespace cppast
 
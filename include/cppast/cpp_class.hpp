@@ -147,7 +147,7 @@ public:
         }
 
         /// \effects Adds a new base class.
-        cpp_base_class& add_base_class(std::unique_ptr<cpp_base_class> base) noexcept
+        cpp_base_class& add_base_class(std::unique_ptr<cpp_base_class> base)
         {
             auto bptr = base.get();
             class_->bases_.push_back(*class_, std::move(base));
@@ -161,7 +161,7 @@ public:
         }
 
         /// \effects Adds an entity.
-        void add_child(std::unique_ptr<cpp_entity> child) noexcept
+        void add_child(std::unique_ptr<cpp_entity> child)
         {
             class_->add_child(std::move(child));
         }
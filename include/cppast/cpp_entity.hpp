@@ -11,13 +11,15 @@
 #include <type_safe/optional_ref.hpp>
 
 #include <cppast/cpp_attribute.hpp>
+#include <cppast/cpp_entity_kind.hpp>
+#include <cppast/cpp_string.hpp>
 #include <cppast/cpp_token.hpp>
+#include <cppast/detail/arena.hpp>
 #include <cppast/detail/intrusive_list.hpp>
 
 namespace cppast
 {
 class cpp_entity;
-enum class cpp_entity_kind;
 class cpp_entity_index;
 struct cpp_entity_id;
 class cpp_template_parameter;
@@ -59,17 +61,38 @@ public:
 
     virtual ~cpp_entity() noexcept = default;
 
+    /// \exclude
+    static void* operator new(std::size_t size)
+    {
+        return detail::allocate_node(size);
+    }
+
+    /// \exclude
+    static void operator delete(void* ptr) noexcept
+    {
+        detail::deallocate_node(ptr);
+    }
+
     /// \returns The kind of the entity.
+    /// \notes The kind is stored in the entity after the first call,
+    /// so only that one needs a virtual call.
     cpp_entity_kind kind() const noexcept
     {
-        return do_get_entity_kind();
+        auto kind = entity_kind_.load(std::memory_order_relaxed);
+        if (kind == cpp_entity_kind::count)
+        {
+            // every thread computes the same kind, so no further synchronization is necessary
+            kind = do_get_entity_kind();
+            entity_kind_.store(kind, std::memory_order_relaxed);
+        }
+        return kind;
     }
 
     /// \returns The name of the entity.
     /// The name is the string associated with the entity's declaration.
     const std::string& name() const noexcept
     {
-        return name_;
+        return name_.str();
     }
 
     /// \returns The name of the new scope created by the entity,
@@ -159,7 +182,9 @@ public:
     }
     
     /// \effects Creates it giving it the the name.
-    cpp_entity(std::string name) : name_(std::move(name)), user_data_(nullptr) {}
+    cpp_entity(std::string name)
+    : name_(std::move(name)), user_data_(nullptr), entity_kind_(cpp_entity_kind::count)
+    {}
 
 private:
     /// \returns The kind of the entity.
@@ -177,11 +202,12 @@ private:
         parent_ = type_safe::ref(parent);
     }
 
-    std::string                               name_;
+    cpp_string                                name_;
     std::string                               comment_;
     cpp_attribute_list                        attributes_;
     type_safe::optional_ref<const cpp_entity> parent_;
     mutable std::atomic<void*>                user_data_;
+    mutable std::atomic<cpp_entity_kind>      entity_kind_; // count until kind() is called
 
     template <typename T>
     friend struct detail::intrusive_list_access;
@@ -12,6 +12,8 @@ namespace cppast
 /// Helper class for entities that are containers.
 ///
 /// Inherit from it to generate container access.
+/// The children are stored contiguously, the iterators are random access.
+/// \notes Adding a child invalidates all iterators, but not references to the children.
 template <class Derived, typename T>
 class cpp_entity_container
 {
@@ -30,9 +32,15 @@ public:
         return children_.end();
     }
 
+    /// \returns The number of children.
+    std::size_t size() const noexcept
+    {
+        return children_.size();
+    }
+
 protected:
     /// \effects Adds a new child to the container.
-    void add_child(std::unique_ptr<T> ptr) noexcept
+    void add_child(std::unique_ptr<T> ptr)
     {
         children_.push_back(static_cast<Derived&>(*this), std::move(ptr));
     }
@@ -46,7 +54,7 @@ protected:
     /// \returns A non-const iterator one past the last child.
     typename detail::intrusive_list<T>::iterator mutable_end() noexcept
     {
-        return children_.begin();
+        return children_.end();
     }
 
     ~cpp_entity_container() noexcept = default;
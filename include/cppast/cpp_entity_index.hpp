@@ -5,6 +5,8 @@
 #ifndef CPPAST_CPP_ENTITY_INDEX_HPP_INCLUDED
 #define CPPAST_CPP_ENTITY_INDEX_HPP_INCLUDED
 
+#include <array>
+#include <atomic>
 #include <cstdint>
 #include <mutex>
 #include <string>
@@ -68,9 +70,19 @@ public:
         duplicate_definition_error();
     };
 
+    /// Exception thrown when registering an entity in a frozen index.
+    class frozen_error : public std::logic_error
+    {
+    public:
+        frozen_error();
+    };
+
+    cpp_entity_index() noexcept : frozen_(false) {}
+
     /// \effects Registers a new [cppast::cpp_entity]() which is a definition.
     /// It will override any previously registered declarations of the same entity.
-    /// \throws duplicate_defintion_error if the entity has been registered as definition before.
+    /// \throws duplicate_defintion_error if the entity has been registered as definition before,
+    /// frozen_error if the index has been frozen.
     /// \requires The entity must live as long as the index lives,
     /// and it must not be a namespace.
     /// \notes This operation is thread safe.
@@ -81,6 +93,7 @@ public:
     /// \returns `true` if the file was not registered before.
     /// If it returns `false`, the file was registered before and nothing was changed.
     /// \requires The entity must live as long as the index lives.
+    /// \throws frozen_error if the index has been frozen.
     /// \notes This operation is thread safe.
     bool register_file(cpp_entity_id id, type_safe::object_ref<const cpp_file> file) const;
 
@@ -88,12 +101,14 @@ public:
     /// Only the first declaration will be registered.
     /// \requires The entity must live as long as the index lives.
     /// \requires The entity must be forward declarable.
+    /// \throws frozen_error if the index has been frozen.
     /// \notes This operation is thread safe.
     void register_forward_declaration(cpp_entity_id                           id,
                                       type_safe::object_ref<const cpp_entity> entity) const;
 
     /// \effects Registers a new [cppast::cpp_namespace]().
     /// \notes The namespace object must live as long as the index lives.
+    /// \throws frozen_error if the index has been frozen.
     /// \notes This operation is thread safe.
     void register_namespace(cpp_entity_id id, type_safe::object_ref<const cpp_namespace> ns) const;
 
@@ -112,9 +127,25 @@ public:
     /// \returns A [ts::array_ref]() of references to all namespaces matching the given
     /// [cppast::cpp_entity_id](). If no namespace is found, it returns an empty array reference.
     /// \notes This operation is thread safe.
+    /// The array reference stays valid as long as the index lives,
+    /// but it will not contain namespaces that are registered afterwards.
     auto lookup_namespace(const cpp_entity_id& id) const noexcept
         -> type_safe::array_ref<type_safe::object_ref<const cpp_namespace>>;
 
+    /// \effects Freezes the index.
+    /// All registered entities are moved into an immutable flat table,
+    /// lookups in a frozen index don't need any synchronization.
+    /// \requires No other thread may use the index during the call.
+    /// \notes Call it after parsing all files, registering further entities is an error.
+    /// Freezing an index twice has no effect.
+    void freeze() const;
+
+    /// \returns Whether or not the index has been frozen.
+    bool is_frozen() const noexcept
+    {
+        return frozen_.load(std::memory_order_acquire);
+    }
+
 private:
     struct hash
     {
@@ -134,11 +165,64 @@ private:
         {}
     };
 
-    mutable std::mutex                                     mutex_;
-    mutable std::unordered_map<cpp_entity_id, value, hash> map_;
-    mutable std::unordered_map<cpp_entity_id,
-                               std::vector<type_safe::object_ref<const cpp_namespace>>, hash>
-        ns_;
+    // all namespaces with the same id
+    // the storage is append-only: when a block is full, it is copied into a new block,
+    // but the old one is kept alive, so array_refs returned by lookup_namespace() stay valid
+    class namespace_list
+    {
+    public:
+        void push_back(type_safe::object_ref<const cpp_namespace> ns);
+
+        type_safe::array_ref<type_safe::object_ref<const cpp_namespace>> get() noexcept
+        {
+            auto& block = blocks_.back();
+            return type_safe::ref(block.data(), block.size());
+        }
+
+        std::size_t size() const noexcept
+        {
+            return blocks_.empty() ? 0u : blocks_.back().size();
+        }
+
+    private:
+        std::vector<std::vector<type_safe::object_ref<const cpp_namespace>>> blocks_;
+    };
+
+    // the index is split into shards by the id,
+    // so concurrent registrations of different entities rarely block each other
+    struct shard
+    {
+        std::mutex                                              mutex;
+        std::unordered_map<cpp_entity_id, value, hash>          map;
+        std::unordered_map<cpp_entity_id, namespace_list, hash> ns;
+    };
+
+    shard& get_shard(const cpp_entity_id& id) const noexcept;
+
+    mutable std::array<shard, 32> shards_;
+
+    // the frozen index: open addressing with linear probing,
+    // the size of the tables is a power of two, empty slots have no entity/namespaces
+    struct frozen_value
+    {
+        detail::hash_type id;
+        const cpp_entity* entity;
+        bool              is_definition;
+    };
+
+    // refers to the storage of the namespace_list, which is kept alive
+    struct frozen_namespaces
+    {
+        detail::hash_type                           id;
+        type_safe::object_ref<const cpp_namespace>* data;
+        std::size_t                                 size;
+    };
+
+    void check_not_frozen() const;
+
+    mutable std::vector<frozen_value>      frozen_map_;
+    mutable std::vector<frozen_namespaces> frozen_ns_;
+    mutable std::atomic<bool>              frozen_;
 };
 } // namespace cppast
 
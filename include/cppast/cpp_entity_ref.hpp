@@ -10,6 +10,7 @@
 #include <type_safe/variant.hpp>
 
 #include <cppast/cpp_entity_index.hpp>
+#include <cppast/cpp_string.hpp>
 #include <cppast/detail/assert.hpp>
 
 namespace cppast
@@ -39,7 +40,7 @@ public:
     /// \returns The name of the reference, as spelled in the source code.
     const std::string& name() const noexcept
     {
-        return name_;
+        return name_.str();
     }
 
     /// \returns Whether or not it refers to multiple entities.
@@ -107,7 +108,7 @@ private:
     }
 
     type_safe::variant<cpp_entity_id, std::vector<cpp_entity_id>> target_;
-    std::string                                                   name_;
+    cpp_string                                                    name_;
 };
 
 /// \exclude
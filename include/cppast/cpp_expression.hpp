@@ -30,6 +30,18 @@ public:
 
     virtual ~cpp_expression() noexcept = default;
 
+    /// \exclude
+    static void* operator new(std::size_t size)
+    {
+        return detail::allocate_node(size);
+    }
+
+    /// \exclude
+    static void operator delete(void* ptr) noexcept
+    {
+        detail::deallocate_node(ptr);
+    }
+
     /// \returns The [cppast::cpp_expression_kind]().
     cpp_expression_kind kind() const noexcept
     {
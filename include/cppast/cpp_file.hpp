@@ -5,11 +5,15 @@
 #ifndef CPPAST_CPP_FILE_HPP_INCLUDED
 #define CPPAST_CPP_FILE_HPP_INCLUDED
 
+#include <cstddef>
+#include <memory>
+#include <mutex>
 #include <vector>
 
 #include <cppast/cpp_entity_container.hpp>
 #include <cppast/cpp_entity_index.hpp>
 #include <cppast/cpp_entity_ref.hpp>
+#include <cppast/cpp_type_context.hpp>
 
 namespace cppast
 {
@@ -22,10 +26,46 @@ struct cpp_doc_comment
     cpp_doc_comment(std::string content, unsigned line) : content(std::move(content)), line(line) {}
 };
 
+/// \exclude
+namespace detail
+{
+    // holds the arena and the shared types of a file
+    // it is the first base class, so they are destroyed after the children
+    class cpp_file_storage
+    {
+    protected:
+        cpp_file_storage() noexcept = default;
+        ~cpp_file_storage() noexcept = default;
+
+        std::unique_ptr<arena> arena_;
+        // shared types may be allocated in the arena, so they are destroyed first
+        std::unique_ptr<cpp_type_context> types_;
+    };
+} // namespace detail
+
+class cpp_file;
+
+/// \exclude
+namespace detail
+{
+    struct cpp_file_access
+    {
+        // the arena owned by the file, nullptr if it doesn't have one
+        static const arena* get_arena(const cpp_file& file) noexcept;
+    };
+
+    using kind_callback_t = void (*)(void* functor, const cpp_entity& e);
+
+    void for_each_of_kind(const cpp_file& file, const cpp_entity_kind* kinds, std::size_t no_kinds,
+                          kind_callback_t cb, void* functor);
+} // namespace detail
+
 /// A [cppast::cpp_entity]() modelling a file.
 ///
 /// This is the top-level entity of the AST.
-class cpp_file final : public cpp_entity, public cpp_entity_container<cpp_file, cpp_entity>
+class cpp_file final : detail::cpp_file_storage,
+                       public cpp_entity,
+                       public cpp_entity_container<cpp_file, cpp_entity>
 {
 public:
     static cpp_entity_kind kind() noexcept;
@@ -38,7 +78,7 @@ public:
         explicit builder(std::string name) : file_(new cpp_file(std::move(name))) {}
 
         /// \effects Adds an entity.
-        void add_child(std::unique_ptr<cpp_entity> child) noexcept
+        void add_child(std::unique_ptr<cpp_entity> child)
         {
             file_->add_child(std::move(child));
         }
@@ -49,6 +89,31 @@ public:
             file_->comments_.push_back(std::move(comment));
         }
 
+        /// \effects Creates an arena owned by the file, if it doesn't have one already.
+        /// All entities, types and expressions the current thread creates
+        /// while a `detail::arena_scope` for it is alive are allocated in the arena.
+        /// \returns The arena.
+        /// \requires The objects allocated in the arena must not outlive the file.
+        /// \notes This is an optimization for parsers: allocation is just a pointer bump,
+        /// and the memory is released at once when the file is destroyed.
+        detail::arena& use_arena()
+        {
+            if (!file_->arena_)
+                file_->arena_.reset(new detail::arena);
+            return *file_->arena_;
+        }
+
+        /// \effects Creates a [cppast::cpp_type_context]() owned by the file,
+        /// if it doesn't have one already.
+        /// \returns The context.
+        /// \requires The types sharing subtypes in the context must not outlive the file.
+        cpp_type_context& use_type_context()
+        {
+            if (!file_->types_)
+                file_->types_.reset(new cpp_type_context);
+            return *file_->types_;
+        }
+
         /// \returns The not yet finished file.
         cpp_file& get() noexcept
         {
@@ -58,7 +123,8 @@ public:
         /// \effects Registers the file in the [cppast::cpp_entity_index]().
         /// It will use the file name as identifier.
         /// \returns The finished file, or `nullptr`, if that file was already registered.
-        std::unique_ptr<cpp_file> finish(const cpp_entity_index& idx) noexcept
+        /// \throws [cppast::cpp_entity_index::frozen_error]() if the index has been frozen.
+        std::unique_ptr<cpp_file> finish(const cpp_entity_index& idx)
         {
             auto res = idx.register_file(cpp_entity_id(file_->name()), type_safe::ref(*file_));
             return res ? std::move(file_) : nullptr;
@@ -68,6 +134,8 @@ public:
         std::unique_ptr<cpp_file> file_;
     };
 
+    ~cpp_file() noexcept override;
+
     /// \returns The unmatched documentation comments.
     type_safe::array_ref<const cpp_doc_comment> unmatched_comments() const noexcept
     {
@@ -75,14 +143,46 @@ public:
     }
 
 private:
-    cpp_file(std::string name) : cpp_entity(std::move(name)) {}
+    cpp_file(std::string name);
 
     /// \returns [cpp_entity_type::file_t]().
     cpp_entity_kind do_get_entity_kind() const noexcept override;
 
-    std::vector<cpp_doc_comment> comments_;
+    // all entities of the file sorted by kind, built on first use
+    struct kind_index;
+
+    const kind_index& get_kind_index() const;
+
+    std::vector<cpp_doc_comment>        comments_;
+    mutable std::once_flag              kind_index_flag_;
+    mutable std::unique_ptr<kind_index> kind_index_;
+
+    friend detail::cpp_file_access;
+    friend void detail::for_each_of_kind(const cpp_file& file, const cpp_entity_kind* kinds,
+                                         std::size_t no_kinds, kind_callback_t cb, void* functor);
 };
 
+/// Visits all entities of the given kinds in a file.
+///
+/// \effects Invokes `f` with every entity of the file that has one of the `Kinds`,
+/// in the order [cppast::visit]() would visit them.
+/// \requires `f` must be callable with a [cppast::cpp_entity]().
+/// \notes Unlike a visit with a [cppast::whitelist](), it does not walk all entities:
+/// the file keeps an index of its entities by kind, so only the matching entities are touched.
+/// The index is built on the first call, which is thread safe.
+/// The file must not be modified afterwards.
+template <cpp_entity_kind... Kinds, typename Func>
+void for_each_of_kind(const cpp_file& file, Func f)
+{
+    static_assert(sizeof...(Kinds) > 0, "At least one entity kind must be specified");
+    const cpp_entity_kind kinds[] = {Kinds...};
+    detail::for_each_of_kind(file, kinds, sizeof...(Kinds),
+                             [](void* functor, const cpp_entity& e) {
+                                 (*static_cast<Func*>(functor))(e);
+                             },
+                             &f);
+}
+
 /// \exclude
 namespace detail
 {
@@ -66,7 +66,7 @@ public:
 
 private:
     cpp_function_type(std::unique_ptr<cpp_type> return_type)
-    : return_type_(std::move(return_type)), variadic_(false)
+    : return_type_(return_type.release()), variadic_(false)
     {}
 
     cpp_type_kind do_get_kind() const noexcept override
@@ -74,9 +74,11 @@ private:
         return cpp_type_kind::function_t;
     }
 
-    std::unique_ptr<cpp_type>        return_type_;
+    detail::cpp_type_ptr             return_type_;
     detail::intrusive_list<cpp_type> parameters_;
     bool                             variadic_;
+
+    friend cpp_type_context;
 };
 
 /// A [cppast::cpp_type]() that is a member function.
@@ -146,7 +148,7 @@ public:
 private:
     cpp_member_function_type(std::unique_ptr<cpp_type> class_type,
                              std::unique_ptr<cpp_type> return_type)
-    : class_type_(std::move(class_type)), return_type_(std::move(return_type)), variadic_(false)
+    : class_type_(class_type.release()), return_type_(return_type.release()), variadic_(false)
     {}
 
     cpp_type_kind do_get_kind() const noexcept override
@@ -154,9 +156,11 @@ private:
         return cpp_type_kind::member_function_t;
     }
 
-    std::unique_ptr<cpp_type>        class_type_, return_type_;
+    detail::cpp_type_ptr             class_type_, return_type_;
     detail::intrusive_list<cpp_type> parameters_;
     bool                             variadic_;
+
+    friend cpp_type_context;
 };
 
 /// A [cppast::cpp_type]() that is a member object.
@@ -188,7 +192,7 @@ public:
 private:
     cpp_member_object_type(std::unique_ptr<cpp_type> class_type,
                            std::unique_ptr<cpp_type> object_type)
-    : class_type_(std::move(class_type)), object_type_(std::move(object_type))
+    : class_type_(class_type.release()), object_type_(object_type.release())
     {}
 
     cpp_type_kind do_get_kind() const noexcept override
@@ -196,7 +200,9 @@ private:
         return cpp_type_kind::member_object_t;
     }
 
-    std::unique_ptr<cpp_type> class_type_, object_type_;
+    detail::cpp_type_ptr class_type_, object_type_;
+
+    friend cpp_type_context;
 };
 } // namespace cppast
 
@@ -29,7 +29,7 @@ public:
         {}
 
         /// \effects Adds an entity.
-        void add_child(std::unique_ptr<cpp_entity> child) noexcept
+        void add_child(std::unique_ptr<cpp_entity> child)
         {
             namespace_->add_child(std::move(child));
         }
@@ -0,0 +1,183 @@
+// Copyright (C) 2017-2019 Jonathan Müller <jonathanmueller.dev@gmail.com>
+// This file is subject to the license terms in the LICENSE file
+// found in the top-level directory of this distribution.
+
+#ifndef CPPAST_CPP_STRING_HPP_INCLUDED
+#define CPPAST_CPP_STRING_HPP_INCLUDED
+
+#include <cstddef>
+#include <functional>
+#include <ostream>
+#include <string>
+
+namespace cppast
+{
+/// \exclude
+namespace detail
+{
+    const std::string* intern_string(const std::string& str);
+
+    const std::string* empty_string() noexcept;
+} // namespace detail
+
+/// An interned string.
+///
+/// All equal strings share a single copy in a global pool,
+/// which makes copying, comparing and hashing them cheap.
+/// It is used for names and token spellings in the AST.
+/// \notes Strings in the pool are never freed.
+class cpp_string
+{
+public:
+    /// \effects Creates the empty string.
+    cpp_string() noexcept : str_(detail::empty_string()) {}
+
+    /// \effects Creates it from the given string, adding it to the pool if necessary.
+    /// \notes This operation is thread safe.
+    /// \group ctor
+    cpp_string(const std::string& str) : str_(detail::intern_string(str)) {}
+
+    /// \group ctor
+    cpp_string(const char* str) : cpp_string(std::string(str)) {}
+
+    /// \returns The string.
+    const std::string& str() const noexcept
+    {
+        return *str_;
+    }
+
+    /// \returns The string.
+    operator const std::string&() const noexcept
+    {
+        return *str_;
+    }
+
+    /// \returns The null-terminated string.
+    const char* c_str() const noexcept
+    {
+        return str_->c_str();
+    }
+
+    /// \returns Whether or not the string is empty.
+    bool empty() const noexcept
+    {
+        return str_->empty();
+    }
+
+    /// \returns The length of the string.
+    std::size_t size() const noexcept
+    {
+        return str_->size();
+    }
+
+    /// \returns The character at the given position.
+    char operator[](std::size_t i) const noexcept
+    {
+        return (*str_)[i];
+    }
+
+    /// \returns The first character.
+    char front() const noexcept
+    {
+        return str_->front();
+    }
+
+    /// \returns The last character.
+    char back() const noexcept
+    {
+        return str_->back();
+    }
+
+    /// \returns The hash of the string, it is unique for every string in the pool.
+    std::size_t hash() const noexcept
+    {
+        return std::hash<const std::string*>()(str_);
+    }
+
+    /// \returns Whether or not both strings are equal.
+    /// \notes This is a single pointer comparison.
+    friend bool operator==(const cpp_string& lhs, const cpp_string& rhs) noexcept
+    {
+        return lhs.str_ == rhs.str_;
+    }
+
+    /// \returns Whether or not both strings are equal.
+    /// \group equal
+    friend bool operator==(const cpp_string& lhs, const std::string& rhs) noexcept
+    {
+        return *lhs.str_ == rhs;
+    }
+
+    /// \group equal
+    friend bool operator==(const std::string& lhs, const cpp_string& rhs) noexcept
+    {
+        return lhs == *rhs.str_;
+    }
+
+    /// \group equal
+    friend bool operator==(const cpp_string& lhs, const char* rhs) noexcept
+    {
+        return *lhs.str_ == rhs;
+    }
+
+    /// \group equal
+    friend bool operator==(const char* lhs, const cpp_string& rhs) noexcept
+    {
+        return lhs == *rhs.str_;
+    }
+
+    /// \returns Whether or not both strings are different.
+    /// \group not_equal
+    friend bool operator!=(const cpp_string& lhs, const cpp_string& rhs) noexcept
+    {
+        return !(lhs == rhs);
+    }
+
+    /// \group not_equal
+    friend bool operator!=(const cpp_string& lhs, const std::string& rhs) noexcept
+    {
+        return !(lhs == rhs);
+    }
+
+    /// \group not_equal
+    friend bool operator!=(const std::string& lhs, const cpp_string& rhs) noexcept
+    {
+        return !(lhs == rhs);
+    }
+
+    /// \group not_equal
+    friend bool operator!=(const cpp_string& lhs, const char* rhs) noexcept
+    {
+        return !(lhs == rhs);
+    }
+
+    /// \group not_equal
+    friend bool operator!=(const char* lhs, const cpp_string& rhs) noexcept
+    {
+        return !(lhs == rhs);
+    }
+
+private:
+    const std::string* str_;
+};
+
+/// \effects Writes the string to the stream.
+inline std::ostream& operator<<(std::ostream& out, const cpp_string& str)
+{
+    return out << str.str();
+}
+} // namespace cppast
+
+namespace std
+{
+template <>
+struct hash<cppast::cpp_string>
+{
+    std::size_t operator()(const cppast::cpp_string& str) const noexcept
+    {
+        return str.hash();
+    }
+};
+} // namespace std
+
+#endif // CPPAST_CPP_STRING_HPP_INCLUDED
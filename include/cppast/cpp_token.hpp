@@ -5,11 +5,15 @@
 #ifndef CPPAST_CPP_TOKEN_HPP_INCLUDED
 #define CPPAST_CPP_TOKEN_HPP_INCLUDED
 
+#include <cstddef>
+#include <iterator>
 #include <string>
 #include <vector>
 
 #include <type_safe/reference.hpp>
 
+#include <cppast/cpp_string.hpp>
+
 namespace cppast
 {
 /// The kinds of C++ tokens.
@@ -27,11 +31,10 @@ enum class cpp_token_kind
 /// A C++ token.
 struct cpp_token
 {
-    std::string    spelling;
+    cpp_string     spelling;
     cpp_token_kind kind;
 
-    cpp_token(cpp_token_kind kind, std::string spelling) : spelling(std::move(spelling)), kind(kind)
-    {}
+    cpp_token(cpp_token_kind kind, cpp_string spelling) : spelling(spelling), kind(kind) {}
 
     friend bool operator==(const cpp_token& lhs, const cpp_token& rhs) noexcept
     {
@@ -45,6 +48,9 @@ struct cpp_token
 };
 
 /// A combination of multiple C++ tokens.
+///
+/// The spellings and kinds of the tokens are stored in two separate arrays,
+/// iterating over it creates the [cppast::cpp_token]() objects on the fly.
 class cpp_token_string
 {
 public:
@@ -57,7 +63,8 @@ public:
         /// \effects Adds a token.
         void add_token(cpp_token tok)
         {
-            tokens_.push_back(std::move(tok));
+            spellings_.push_back(tok.spelling);
+            kinds_.push_back(static_cast<unsigned char>(tok.kind));
         }
 
         /// \effects Converts a trailing `>>` to `>` token.
@@ -66,11 +73,12 @@ public:
         /// \returns The finished string.
         cpp_token_string finish()
         {
-            return cpp_token_string(std::move(tokens_));
+            return cpp_token_string(std::move(spellings_), std::move(kinds_));
         }
 
     private:
-        std::vector<cpp_token> tokens_;
+        std::vector<cpp_string>    spellings_;
+        std::vector<unsigned char> kinds_;
     };
 
     /// Tokenizes a string.
@@ -80,46 +88,204 @@ public:
     static cpp_token_string tokenize(std::string str);
 
     /// \effects Creates it from a sequence of tokens.
-    cpp_token_string(std::vector<cpp_token> tokens) : tokens_(std::move(tokens)) {}
+    cpp_token_string(const std::vector<cpp_token>& tokens);
 
     /// \exclude target
-    using iterator = std::vector<cpp_token>::const_iterator;
+    class iterator
+    {
+    public:
+        /// \exclude
+        struct pointer
+        {
+            cpp_token token;
+
+            const cpp_token* operator->() const noexcept
+            {
+                return &token;
+            }
+        };
+
+        // the tokens are created on the fly, so the reference is a value,
+        // which only an input iterator allows
+        // it is const, so `auto&` can still bind to it
+        using value_type        = cpp_token;
+        using reference         = const cpp_token;
+        using difference_type   = std::ptrdiff_t;
+        using iterator_category = std::input_iterator_tag;
+
+        iterator() noexcept : spelling_(nullptr), kind_(nullptr) {}
+
+        reference operator*() const noexcept
+        {
+            return cpp_token(static_cast<cpp_token_kind>(*kind_), *spelling_);
+        }
+
+        pointer operator->() const noexcept
+        {
+            return pointer{**this};
+        }
+
+        reference operator[](difference_type n) const noexcept
+        {
+            return *(*this + n);
+        }
+
+        iterator& operator++() noexcept
+        {
+            ++spelling_;
+            ++kind_;
+            return *this;
+        }
+
+        iterator operator++(int) noexcept
+        {
+            auto tmp = *this;
+            ++(*this);
+            return tmp;
+        }
+
+        iterator& operator--() noexcept
+        {
+            --spelling_;
+            --kind_;
+            return *this;
+        }
+
+        iterator operator--(int) noexcept
+        {
+            auto tmp = *this;
+            --(*this);
+            return tmp;
+        }
+
+        iterator& operator+=(difference_type n) noexcept
+        {
+            spelling_ += n;
+            kind_ += n;
+            return *this;
+        }
+
+        iterator& operator-=(difference_type n) noexcept
+        {
+            spelling_ -= n;
+            kind_ -= n;
+            return *this;
+        }
+
+        friend iterator operator+(iterator iter, difference_type n) noexcept
+        {
+            return iter += n;
+        }
+
+        friend iterator operator+(difference_type n, iterator iter) noexcept
+        {
+            return iter += n;
+        }
+
+        friend iterator operator-(iterator iter, difference_type n) noexcept
+        {
+            return iter -= n;
+        }
+
+        friend difference_type operator-(const iterator& a, const iterator& b) noexcept
+        {
+            return a.spelling_ - b.spelling_;
+        }
+
+        friend bool operator==(const iterator& a, const iterator& b) noexcept
+        {
+            return a.spelling_ == b.spelling_;
+        }
+
+        friend bool operator!=(const iterator& a, const iterator& b) noexcept
+        {
+            return !(a == b);
+        }
+
+        friend bool operator<(const iterator& a, const iterator& b) noexcept
+        {
+            return a.spelling_ < b.spelling_;
+        }
+
+        friend bool operator>(const iterator& a, const iterator& b) noexcept
+        {
+            return b < a;
+        }
+
+        friend bool operator<=(const iterator& a, const iterator& b) noexcept
+        {
+            return !(b < a);
+        }
+
+        friend bool operator>=(const iterator& a, const iterator& b) noexcept
+        {
+            return !(a < b);
+        }
+
+    private:
+        iterator(const cpp_string* spelling, const unsigned char* kind) noexcept
+        : spelling_(spelling), kind_(kind)
+        {}
+
+        const cpp_string*    spelling_;
+        const unsigned char* kind_;
+
+        friend cpp_token_string;
+    };
 
     /// \returns An iterator to the first token.
+    /// \notes The tokens are not stored as [cppast::cpp_token]() objects,
+    /// so dereferencing the iterator returns a `const` token by value,
+    /// and it is only an input iterator.
+    /// It still supports the arithmetic and comparison operations of a random access iterator,
+    /// use [*size]() to get the number of tokens in constant time.
     iterator begin() const noexcept
     {
-        return tokens_.begin();
+        return iterator(spellings_.data(), kinds_.data());
     }
 
     /// \returns An iterator one past the last token.
     iterator end() const noexcept
     {
-        return tokens_.end();
+        return iterator(spellings_.data() + spellings_.size(), kinds_.data() + kinds_.size());
     }
 
     /// \returns Whether or not the string is empty.
     bool empty() const noexcept
     {
-        return tokens_.empty();
+        return spellings_.empty();
     }
 
-    /// \returns A reference to the first token.
-    const cpp_token& front() const noexcept
+    /// \returns The number of tokens.
+    std::size_t size() const noexcept
     {
-        return tokens_.front();
+        return spellings_.size();
     }
 
-    /// \returns A reference to the last token.
-    const cpp_token& back() const noexcept
+    /// \returns The first token.
+    /// \notes Like dereferencing an iterator, it returns the token by value.
+    cpp_token front() const noexcept
     {
-        return tokens_.back();
+        return *begin();
+    }
+
+    /// \returns The last token.
+    /// \notes Like dereferencing an iterator, it returns the token by value.
+    cpp_token back() const noexcept
+    {
+        return *(end() - 1);
     }
 
     /// \returns The string representation of the tokens, without any whitespace.
     std::string as_string() const;
 
 private:
-    std::vector<cpp_token> tokens_;
+    cpp_token_string(std::vector<cpp_string> spellings, std::vector<unsigned char> kinds) noexcept
+    : spellings_(std::move(spellings)), kinds_(std::move(kinds))
+    {}
+
+    std::vector<cpp_string>    spellings_;
+    std::vector<unsigned char> kinds_;
 
     friend bool operator==(const cpp_token_string& lhs, const cpp_token_string& rhs);
 };
@@ -10,6 +10,8 @@
 
 #include <cppast/code_generator.hpp>
 #include <cppast/cpp_entity_ref.hpp>
+#include <cppast/cpp_string.hpp>
+#include <cppast/detail/arena.hpp>
 #include <cppast/detail/intrusive_list.hpp>
 
 namespace cppast
@@ -41,6 +43,22 @@ enum class cpp_type_kind
     unexposed_t,
 };
 
+class cpp_type;
+class cpp_type_context;
+
+/// \exclude
+namespace detail
+{
+    // deletes the type, unless it is shared by a cpp_type_context
+    struct cpp_type_deleter
+    {
+        void operator()(cpp_type* type) const noexcept;
+    };
+
+    // owns a subtype of a type, which may be shared
+    using cpp_type_ptr = std::unique_ptr<cpp_type, cpp_type_deleter>;
+} // namespace detail
+
 /// Base class for all C++ types.
 class cpp_type : detail::intrusive_list_node<cpp_type>
 {
@@ -50,6 +68,18 @@ public:
 
     virtual ~cpp_type() noexcept = default;
 
+    /// \exclude
+    static void* operator new(std::size_t size)
+    {
+        return detail::allocate_node(size);
+    }
+
+    /// \exclude
+    static void operator delete(void* ptr) noexcept
+    {
+        detail::deallocate_node(ptr);
+    }
+
     /// \returns The [cppast::cpp_type_kind]().
     cpp_type_kind kind() const noexcept
     {
@@ -69,13 +99,21 @@ public:
     ///
     /// User data is useful if you need to store additional data for an entity without the need to
     /// maintain a registry.
+    /// \notes If the type is shared, the user data is shared as well.
     void set_user_data(void* data) const noexcept
     {
         user_data_ = data;
     }
 
+    /// \returns Whether or not the type is shared by multiple types,
+    /// see [cppast::cpp_type_context]().
+    bool is_shared() const noexcept
+    {
+        return shared_;
+    }
+
 protected:
-    cpp_type() noexcept : user_data_(nullptr) {}
+    cpp_type() noexcept : user_data_(nullptr), shared_(false) {}
 
 private:
     /// \returns The [cppast::cpp_type_kind]().
@@ -84,12 +122,21 @@ private:
     void on_insert(const cpp_type&) {}
 
     mutable std::atomic<void*> user_data_;
+    bool                       shared_;
 
     template <typename T>
     friend struct detail::intrusive_list_access;
     friend detail::intrusive_list_node<cpp_type>;
+    friend cpp_type_context;
 };
 
+inline void detail::cpp_type_deleter::operator()(cpp_type* type) const noexcept
+{
+    // shared types are owned by the context
+    if (!type->is_shared())
+        delete type;
+}
+
 /// An unexposed [cppast::cpp_type]().
 ///
 /// This is one where no further information besides a name is available.
@@ -105,7 +152,7 @@ public:
     /// \returns The name of the type.
     const std::string& name() const noexcept
     {
-        return name_;
+        return name_.str();
     }
 
 private:
@@ -116,7 +163,7 @@ private:
         return cpp_type_kind::unexposed_t;
     }
 
-    std::string name_;
+    cpp_string name_;
 };
 
 /// The C++ builtin types.
@@ -265,7 +312,7 @@ public:
     /// \notes It does not include a scope.
     const std::string& name() const noexcept
     {
-        return name_;
+        return name_.str();
     }
 
     /// \returns A reference to the [cppast::cpp_type]() it depends one.
@@ -278,7 +325,7 @@ public:
 
 private:
     cpp_dependent_type(std::string name, std::unique_ptr<cpp_type> dependee)
-    : name_(std::move(name)), dependee_(std::move(dependee))
+    : name_(std::move(name)), dependee_(dependee.release())
     {}
 
     cpp_type_kind do_get_kind() const noexcept override
@@ -286,8 +333,10 @@ private:
         return cpp_type_kind::dependent_t;
     }
 
-    std::string               name_;
-    std::unique_ptr<cpp_type> dependee_;
+    cpp_string           name_;
+    detail::cpp_type_ptr dependee_;
+
+    friend cpp_type_context;
 };
 
 /// The kinds of C++ cv qualifiers.
@@ -338,7 +387,7 @@ public:
 
 private:
     cpp_cv_qualified_type(std::unique_ptr<cpp_type> type, cpp_cv cv)
-    : type_(std::move(type)), cv_(cv)
+    : type_(type.release()), cv_(cv)
     {}
 
     cpp_type_kind do_get_kind() const noexcept override
@@ -346,8 +395,10 @@ private:
         return cpp_type_kind::cv_qualified_t;
     }
 
-    std::unique_ptr<cpp_type> type_;
-    cpp_cv                    cv_;
+    detail::cpp_type_ptr type_;
+    cpp_cv               cv_;
+
+    friend cpp_type_context;
 };
 
 /// \returns The type without top-level const/volatile qualifiers.
@@ -376,14 +427,16 @@ public:
     }
 
 private:
-    cpp_pointer_type(std::unique_ptr<cpp_type> pointee) : pointee_(std::move(pointee)) {}
+    cpp_pointer_type(std::unique_ptr<cpp_type> pointee) : pointee_(pointee.release()) {}
 
     cpp_type_kind do_get_kind() const noexcept override
     {
         return cpp_type_kind::pointer_t;
     }
 
-    std::unique_ptr<cpp_type> pointee_;
+    detail::cpp_type_ptr pointee_;
+
+    friend cpp_type_context;
 };
 
 /// The kinds of C++ references.
@@ -421,7 +474,7 @@ public:
 
 private:
     cpp_reference_type(std::unique_ptr<cpp_type> referee, cpp_reference ref)
-    : referee_(std::move(referee)), ref_(ref)
+    : referee_(referee.release()), ref_(ref)
     {}
 
     cpp_type_kind do_get_kind() const noexcept override
@@ -429,8 +482,10 @@ private:
         return cpp_type_kind::reference_t;
     }
 
-    std::unique_ptr<cpp_type> referee_;
-    cpp_reference             ref_;
+    detail::cpp_type_ptr referee_;
+    cpp_reference        ref_;
+
+    friend cpp_type_context;
 };
 
 /// \returns The type as a string representation.
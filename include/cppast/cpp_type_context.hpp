@@ -0,0 +1,69 @@
+// Copyright (C) 2017-2019 Jonathan Müller <jonathanmueller.dev@gmail.com>
+// This file is subject to the license terms in the LICENSE file
+// found in the top-level directory of this distribution.
+
+#ifndef CPPAST_CPP_TYPE_CONTEXT_HPP_INCLUDED
+#define CPPAST_CPP_TYPE_CONTEXT_HPP_INCLUDED
+
+#include <memory>
+#include <unordered_set>
+#include <vector>
+
+#include <cppast/cpp_type.hpp>
+
+namespace cppast
+{
+/// Shares structurally identical [cppast::cpp_type]() objects.
+///
+/// A type is uniquely owned by its entity, expression or parent type,
+/// but the subtypes of a type can be replaced by a single shared copy owned by the context.
+/// Then the memory only grows with the number of distinct subtypes,
+/// and two types shared by the same context are equal if and only if they have the same address.
+///
+/// A type can be shared if all of its subtypes are shared
+/// and it is not an array, function, member function, `decltype` or template instantiation type.
+/// The subtypes of those are shared nonetheless.
+class cpp_type_context
+{
+public:
+    cpp_type_context() = default;
+
+    cpp_type_context(const cpp_type_context&) = delete;
+    cpp_type_context& operator=(const cpp_type_context&) = delete;
+
+    ~cpp_type_context() noexcept;
+
+    /// \effects Replaces all subtypes of the given type with their shared copy,
+    /// adding it to the context if it is a new type.
+    /// The type itself is not shared.
+    /// \requires The context must live as long as the type.
+    /// \notes This operation is not thread safe.
+    void share_subtypes(cpp_type& type);
+
+    /// \returns The number of distinct types shared by the context.
+    std::size_t size() const noexcept
+    {
+        return storage_.size();
+    }
+
+private:
+    void share(detail::cpp_type_ptr& type);
+
+    // hash and equality of types whose subtypes are shared
+    struct hash
+    {
+        std::size_t operator()(const cpp_type* type) const noexcept;
+    };
+
+    struct equal
+    {
+        bool operator()(const cpp_type* lhs, const cpp_type* rhs) const noexcept;
+    };
+
+    std::unordered_set<cpp_type*, hash, equal> types_;
+    // subtypes are always added before the types containing them
+    std::vector<std::unique_ptr<cpp_type>> storage_;
+};
+} // namespace cppast
+
+#endif // CPPAST_CPP_TYPE_CONTEXT_HPP_INCLUDED
@@ -0,0 +1,75 @@
+// Copyright (C) 2017-2019 Jonathan Müller <jonathanmueller.dev@gmail.com>
+// This file is subject to the license terms in the LICENSE file
+// found in the top-level directory of this distribution.
+
+#ifndef CPPAST_ARENA_HPP_INCLUDED
+#define CPPAST_ARENA_HPP_INCLUDED
+
+#include <cstddef>
+
+namespace cppast
+{
+namespace detail
+{
+    // a monotonic buffer for the nodes of the AST
+    // memory is only released when the arena is destroyed
+    class arena
+    {
+    public:
+        arena() noexcept;
+
+        arena(const arena&) = delete;
+        arena& operator=(const arena&) = delete;
+
+        ~arena() noexcept;
+
+        // suitably aligned for every node
+        void* allocate(std::size_t size);
+
+        // number of allocations done in the arena
+        std::size_t no_allocations() const noexcept
+        {
+            return no_allocations_;
+        }
+
+        // memory reserved for the arena in bytes
+        std::size_t capacity() const noexcept
+        {
+            return capacity_;
+        }
+
+    private:
+        struct block;
+
+        block*      head_;
+        char*       cur_;
+        char*       end_;
+        std::size_t no_allocations_, capacity_;
+    };
+
+    // while it is alive, all nodes created by the current thread are allocated in the arena,
+    // or on the heap if it is nullptr
+    class arena_scope
+    {
+    public:
+        explicit arena_scope(arena* a) noexcept;
+
+        arena_scope(const arena_scope&) = delete;
+        arena_scope& operator=(const arena_scope&) = delete;
+
+        ~arena_scope() noexcept;
+
+    private:
+        arena* previous_;
+    };
+
+    // allocation functions for the nodes of the AST,
+    // i.e. entities, types and expressions
+    // deallocation does nothing if the node was allocated in an arena,
+    // the nodes don't store where they were allocated, so heap nodes have no overhead
+    void* allocate_node(std::size_t size);
+    void  deallocate_node(void* ptr) noexcept;
+} // namespace detail
+} // namespace cppast
+
+#endif // CPPAST_ARENA_HPP_INCLUDED
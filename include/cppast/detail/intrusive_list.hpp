@@ -6,7 +6,10 @@
 #define CPPAST_INTRUSIVE_LIST_HPP_INCLUDED
 
 #include <iterator>
+#include <list>
 #include <memory>
+#include <type_traits>
+#include <vector>
 
 #include <type_safe/optional_ref.hpp>
 
@@ -18,11 +21,11 @@ class cpp_file;
 
 namespace detail
 {
+    // base class of the elements of an intrusive_list,
+    // calls T::on_insert() when the element is inserted
     template <typename T>
     class intrusive_list_node
     {
-        std::unique_ptr<T> next_;
-
         void do_on_insert(const T& parent) noexcept
         {
             static_cast<T&>(*this).on_insert(parent);
@@ -35,21 +38,6 @@ namespace detail
     template <typename T>
     struct intrusive_list_access
     {
-        template <typename U>
-        static T* get_next(const U& obj)
-        {
-            static_assert(std::is_base_of<U, T>::value, "must be a base");
-            return static_cast<T*>(obj.next_.get());
-        }
-
-        template <typename U>
-        static T* set_next(U& obj, std::unique_ptr<T> node)
-        {
-            static_assert(std::is_base_of<U, T>::value, "must be a base");
-            obj.next_ = std::move(node);
-            return static_cast<T*>(obj.next_.get());
-        }
-
         template <typename U, typename V>
         static void on_insert(U& obj, const V& parent)
         {
@@ -60,28 +48,35 @@ namespace detail
     template <typename T>
     class intrusive_list_iterator
     {
+        using storage = const std::unique_ptr<typename std::remove_const<T>::type>*;
+
     public:
         using value_type        = T;
         using reference         = T&;
         using pointer           = T*;
         using difference_type   = std::ptrdiff_t;
-        using iterator_category = std::forward_iterator_tag;
+        using iterator_category = std::random_access_iterator_tag;
 
         intrusive_list_iterator() noexcept : cur_(nullptr) {}
 
         reference operator*() const noexcept
         {
-            return *cur_;
+            return **cur_;
         }
 
         pointer operator->() const noexcept
         {
-            return cur_;
+            return cur_->get();
+        }
+
+        reference operator[](difference_type n) const noexcept
+        {
+            return *cur_[n];
         }
 
         intrusive_list_iterator& operator++() noexcept
         {
-            cur_ = intrusive_list_access<T>::get_next(*cur_);
+            ++cur_;
             return *this;
         }
 
@@ -92,6 +87,55 @@ namespace detail
             return tmp;
         }
 
+        intrusive_list_iterator& operator--() noexcept
+        {
+            --cur_;
+            return *this;
+        }
+
+        intrusive_list_iterator operator--(int) noexcept
+        {
+            auto tmp = *this;
+            --(*this);
+            return tmp;
+        }
+
+        intrusive_list_iterator& operator+=(difference_type n) noexcept
+        {
+            cur_ += n;
+            return *this;
+        }
+
+        intrusive_list_iterator& operator-=(difference_type n) noexcept
+        {
+            cur_ -= n;
+            return *this;
+        }
+
+        friend intrusive_list_iterator operator+(intrusive_list_iterator iter,
+                                                 difference_type         n) noexcept
+        {
+            return iter += n;
+        }
+
+        friend intrusive_list_iterator operator+(difference_type         n,
+                                                 intrusive_list_iterator iter) noexcept
+        {
+            return iter += n;
+        }
+
+        friend intrusive_list_iterator operator-(intrusive_list_iterator iter,
+                                                 difference_type         n) noexcept
+        {
+            return iter -= n;
+        }
+
+        friend difference_type operator-(const intrusive_list_iterator& a,
+                                         const intrusive_list_iterator& b) noexcept
+        {
+            return a.cur_ - b.cur_;
+        }
+
         friend bool operator==(const intrusive_list_iterator& a,
                                const intrusive_list_iterator& b) noexcept
         {
@@ -104,15 +148,44 @@ namespace detail
             return !(a == b);
         }
 
+        friend bool operator<(const intrusive_list_iterator& a,
+                              const intrusive_list_iterator& b) noexcept
+        {
+            return a.cur_ < b.cur_;
+        }
+
+        friend bool operator>(const intrusive_list_iterator& a,
+                              const intrusive_list_iterator& b) noexcept
+        {
+            return b < a;
+        }
+
+        friend bool operator<=(const intrusive_list_iterator& a,
+                               const intrusive_list_iterator& b) noexcept
+        {
+            return !(b < a);
+        }
+
+        friend bool operator>=(const intrusive_list_iterator& a,
+                               const intrusive_list_iterator& b) noexcept
+        {
+            return !(a < b);
+        }
+
     private:
-        intrusive_list_iterator(T* ptr) : cur_(ptr) {}
+        intrusive_list_iterator(storage ptr) : cur_(ptr) {}
 
-        T* cur_;
+        storage cur_;
 
         template <typename U>
         friend class intrusive_list;
     };
 
+    // the elements are owned by a vector,
+    // so they are stored contiguously and destroyed without recursion
+    //
+    // unlike a linked list, push_back() invalidates all iterators,
+    // references to the elements themselves stay valid
     template <typename T>
     class intrusive_list
     {
@@ -120,45 +193,43 @@ namespace detail
         intrusive_list() = default;
 
         //=== modifiers ===//
-        template <typename Dummy = T,
-                  typename = typename std::enable_if<std::is_same<Dummy, cpp_file>::value>::type>
-        void push_back(std::unique_ptr<T> obj) noexcept
+        // invalidates all iterators
+        template <typename U>
+        void push_back(const U& parent, std::unique_ptr<T> obj)
         {
             push_back_impl(std::move(obj));
+            intrusive_list_access<T>::on_insert(*elements_.back(), parent);
         }
 
-        template <typename U,
-                  typename = typename std::enable_if<!std::is_same<T, cpp_file>::value, U>::type>
-        void push_back(const U& parent, std::unique_ptr<T> obj) noexcept
+        //=== accesors ===//
+        bool empty() const noexcept
         {
-            push_back_impl(std::move(obj));
-            intrusive_list_access<T>::on_insert(last_.value(), parent);
+            return elements_.empty();
         }
 
-        //=== accesors ===//
-        bool empty() const noexcept
+        std::size_t size() const noexcept
         {
-            return first_ == nullptr;
+            return elements_.size();
         }
 
         type_safe::optional_ref<T> front() noexcept
         {
-            return type_safe::opt_ref(first_.get());
+            return type_safe::opt_ref(empty() ? nullptr : elements_.front().get());
         }
 
         type_safe::optional_ref<const T> front() const noexcept
         {
-            return type_safe::opt_cref(first_.get());
+            return type_safe::opt_cref(empty() ? nullptr : elements_.front().get());
         }
 
         type_safe::optional_ref<T> back() noexcept
         {
-            return last_;
+            return type_safe::opt_ref(empty() ? nullptr : elements_.back().get());
         }
 
         type_safe::optional_ref<const T> back() const noexcept
         {
-            return last_;
+            return type_safe::opt_cref(empty() ? nullptr : elements_.back().get());
         }
 
         //=== iterators ===//
@@ -167,43 +238,155 @@ namespace detail
 
         iterator begin() noexcept
         {
-            return iterator(first_.get());
+            return iterator(elements_.data());
         }
 
         iterator end() noexcept
         {
-            return {};
+            return iterator(elements_.data() + elements_.size());
         }
 
         const_iterator begin() const noexcept
         {
-            return const_iterator(first_.get());
+            return const_iterator(elements_.data());
         }
 
         const_iterator end() const noexcept
         {
-            return {};
+            return const_iterator(elements_.data() + elements_.size());
         }
 
     private:
         void push_back_impl(std::unique_ptr<T> obj)
         {
             DEBUG_ASSERT(obj != nullptr, detail::assert_handler{});
+            elements_.push_back(std::move(obj));
+        }
+
+        std::vector<std::unique_ptr<T>> elements_;
+    };
+
+    template <typename T>
+    class file_list_iterator
+    {
+        using storage = std::list<std::unique_ptr<cpp_file>>::const_iterator;
+
+    public:
+        using value_type        = T;
+        using reference         = T&;
+        using pointer           = T*;
+        using difference_type   = std::ptrdiff_t;
+        using iterator_category = std::bidirectional_iterator_tag;
+
+        file_list_iterator() noexcept = default;
+
+        reference operator*() const noexcept
+        {
+            return **cur_;
+        }
+
+        pointer operator->() const noexcept
+        {
+            return cur_->get();
+        }
+
+        file_list_iterator& operator++() noexcept
+        {
+            ++cur_;
+            return *this;
+        }
+
+        file_list_iterator operator++(int) noexcept
+        {
+            auto tmp = *this;
+            ++(*this);
+            return tmp;
+        }
+
+        file_list_iterator& operator--() noexcept
+        {
+            --cur_;
+            return *this;
+        }
+
+        file_list_iterator operator--(int) noexcept
+        {
+            auto tmp = *this;
+            --(*this);
+            return tmp;
+        }
+
+        friend bool operator==(const file_list_iterator& a, const file_list_iterator& b) noexcept
+        {
+            return a.cur_ == b.cur_;
+        }
+
+        friend bool operator!=(const file_list_iterator& a, const file_list_iterator& b) noexcept
+        {
+            return !(a == b);
+        }
+
+    private:
+        file_list_iterator(storage cur) : cur_(cur) {}
+
+        storage cur_;
+
+        template <typename U>
+        friend class intrusive_list;
+    };
+
+    // the files of a parser are owned by a linked list instead,
+    // push_back() doesn't invalidate any iterators,
+    // so files can be parsed while the already parsed ones are iterated
+    template <>
+    class intrusive_list<cpp_file>
+    {
+    public:
+        intrusive_list() = default;
+
+        //=== modifiers ===//
+        void push_back(std::unique_ptr<cpp_file> obj)
+        {
+            DEBUG_ASSERT(obj != nullptr, detail::assert_handler{});
+            elements_.push_back(std::move(obj));
+        }
+
+        //=== accesors ===//
+        bool empty() const noexcept
+        {
+            return elements_.empty();
+        }
+
+        std::size_t size() const noexcept
+        {
+            return elements_.size();
+        }
 
-            if (last_)
-            {
-                auto ptr = intrusive_list_access<T>::set_next(last_.value(), std::move(obj));
-                last_    = type_safe::ref(*ptr);
-            }
-            else
-            {
-                first_ = std::move(obj);
-                last_  = type_safe::opt_ref(first_.get());
-            }
+        type_safe::optional_ref<const cpp_file> front() const noexcept
+        {
+            return type_safe::opt_cref(empty() ? nullptr : elements_.front().get());
+        }
+
+        type_safe::optional_ref<const cpp_file> back() const noexcept
+        {
+            return type_safe::opt_cref(empty() ? nullptr : elements_.back().get());
         }
 
-        std::unique_ptr<T>         first_;
-        type_safe::optional_ref<T> last_;
+        //=== iterators ===//
+        using const_iterator = file_list_iterator<const cpp_file>;
+
+        const_iterator begin() const noexcept
+        {
+            return const_iterator(elements_.begin());
+        }
+
+        const_iterator end() const noexcept
+        {
+            return const_iterator(elements_.end());
+        }
+
+    private:
+        std::list<std::unique_ptr<cpp_file>> elements_;
     };
 
     template <typename T>
@@ -218,6 +401,11 @@ namespace detail
             return list_->empty();
         }
 
+        std::size_t size() const noexcept
+        {
+            return list_->size();
+        }
+
         using iterator = typename intrusive_list<T>::const_iterator;
 
         iterator begin() const noexcept
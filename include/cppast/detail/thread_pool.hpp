@@ -0,0 +1,89 @@
+// Copyright (C) 2017-2019 Jonathan Müller <jonathanmueller.dev@gmail.com>
+// This file is subject to the license terms in the LICENSE file
+// found in the top-level directory of this distribution.
+
+#ifndef CPPAST_THREAD_POOL_HPP_INCLUDED
+#define CPPAST_THREAD_POOL_HPP_INCLUDED
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace cppast
+{
+namespace detail
+{
+    // a work-stealing thread pool
+    //
+    // every worker owns a deque of tasks,
+    // it pops from the back of its own deque and steals from the front of the others
+    class thread_pool
+    {
+    public:
+        using task = std::function<void()>;
+
+        // number of workers used if zero is requested
+        static unsigned default_size() noexcept;
+
+        // creates a pool with the given number of workers,
+        // zero means default_size()
+        explicit thread_pool(unsigned no_workers = 0u);
+
+        thread_pool(const thread_pool&) = delete;
+        thread_pool& operator=(const thread_pool&) = delete;
+
+        // finishes all pending tasks and joins the workers
+        // exceptions of tasks that have not been rethrown by wait() are discarded
+        ~thread_pool() noexcept;
+
+        // schedules the task
+        // if called from a worker of this pool, it is pushed to the worker's own queue
+        void submit(task t);
+
+        // blocks until all tasks submitted so far have finished,
+        // the calling thread helps executing tasks while waiting
+        // rethrows the first exception thrown by a task
+        void wait();
+
+        unsigned size() const noexcept
+        {
+            return static_cast<unsigned>(workers_.size());
+        }
+
+        // index of the calling worker in [0, size()),
+        // size() if the calling thread is not a worker of this pool
+        std::size_t current_worker() const noexcept;
+
+    private:
+        struct queue
+        {
+            std::mutex       mutex;
+            std::deque<task> tasks;
+        };
+
+        void run_worker(std::size_t index);
+
+        bool try_pop(std::size_t index, task& t);
+        bool try_steal(std::size_t index, task& t);
+
+        void execute(task& t);
+
+        std::vector<std::unique_ptr<queue>> queues_;
+        std::vector<std::thread>            workers_;
+
+        std::mutex              mutex_;
+        std::condition_variable work_available_, work_done_;
+        std::size_t             queued_, unfinished_, next_queue_;
+        std::exception_ptr      exception_;
+        bool                    stop_;
+    };
+} // namespace detail
+} // namespace cppast
+
+#endif // CPPAST_THREAD_POOL_HPP_INCLUDED
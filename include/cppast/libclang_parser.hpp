@@ -27,10 +27,16 @@ namespace detail
         static bool fast_preprocessing(const libclang_compile_config& config);
 
         static bool remove_comments_in_macro(const libclang_compile_config& config);
+
+        static bool in_process_preprocessing(const libclang_compile_config& config);
+
+        static bool skip_function_bodies(const libclang_compile_config& config);
     };
 
+    // invokes the callback with the full path of each file and the index of its configuration,
+    // files with the same index share the same configuration
     void for_each_file(const libclang_compilation_database& database, void* user_data,
-                       void (*callback)(void*, std::string));
+                       void (*callback)(void*, std::string, std::size_t));
 } // namespace detail
 
 /// The exception thrown when a fatal parse error occurs.
@@ -50,25 +56,20 @@ class libclang_compilation_database
 {
 public:
     /// \effects Creates it giving the directory where the `compile_commands.json` file is located.
+    /// All commands are read once and stored in a hash table indexed by the full file path,
+    /// so querying the configuration of a file listed in the database is cheap.
     /// \throws `libclang_error` if the database could not be loaded or found.
     libclang_compilation_database(const std::string& build_directory);
 
-    libclang_compilation_database(libclang_compilation_database&& other)
-    : database_(other.database_)
-    {
-        other.database_ = nullptr;
-    }
+    libclang_compilation_database(libclang_compilation_database&& other) noexcept;
 
     ~libclang_compilation_database();
 
-    libclang_compilation_database& operator=(libclang_compilation_database&& other)
-    {
-        libclang_compilation_database tmp(std::move(other));
-        std::swap(tmp.database_, database_);
-        return *this;
-    }
+    libclang_compilation_database& operator=(libclang_compilation_database&& other) noexcept;
 
     /// \returns Whether or not the database contains information about the given file.
+    /// \notes Absolute paths are looked up in the index only,
+    /// other paths are resolved by libclang.
     /// \group has_config
     bool has_config(const char* file_name) const;
 
@@ -78,13 +79,38 @@ public:
         return has_config(file_name.c_str());
     }
 
+    /// \returns The number of files listed in the database.
+    std::size_t no_files() const noexcept;
+
+    /// \returns The number of distinct configurations of the files listed in the database.
+    /// \notes Two files have the same configuration if the options relevant for cppast are the
+    /// same, most files of a project usually share a few configurations.
+    std::size_t no_configurations() const noexcept;
+
 private:
+    struct index;
+
+    // returns the flags of the file, or nullptr if the index doesn't know it
+    const std::vector<std::string>* lookup_flags(const std::string& file_name) const;
+
+    // returns the file name of the first file with the same path except for the extension
+    // as listed in the extensions, or an empty string
+    std::string lookup_stem(const std::string& file_name, const char* const* extensions,
+                            std::size_t no_extensions) const;
+
+    // whether a file that isn't in the index has no configuration
+    bool is_complete(const std::string& file_name) const;
+
     using database = void*;
-    database database_;
+    database               database_;
+    std::unique_ptr<index> index_;
 
     friend libclang_compile_config;
+    friend type_safe::optional<libclang_compile_config> find_config_for(
+        const libclang_compilation_database& database, std::string file_name);
     friend void detail::for_each_file(const libclang_compilation_database& database,
-                                      void* user_data, void (*callback)(void*, std::string));
+                                      void* user_data,
+                                      void (*callback)(void*, std::string, std::size_t));
 };
 
 /// Compilation config for the [cppast::libclang_parser]().
@@ -125,6 +151,15 @@ public:
     /// order might end up being wrong.
     bool set_clang_binary(std::string binary);
 
+    /// \effects Sets the file where the information obtained by invoking a `clang++` binary is
+    /// persisted, so that subsequent runs don't need to invoke it again.
+    /// An entry is only reused as long as modification time and size of the binary are unchanged.
+    /// If the path is empty, nothing is persisted.
+    /// \notes Regardless of this setting, each binary is only invoked once per process,
+    /// i.e. constructing many configurations doesn't spawn new processes every time.
+    /// \notes This function is thread safe.
+    static void set_toolchain_cache_file(std::string path);
+
     /// \effects Sets whether or not the preprocessed file will be written out.
     /// Default value is `false`.
     void write_preprocessed(bool b) noexcept
@@ -154,6 +189,32 @@ public:
         remove_comments_in_macro_ = b;
     }
 
+    /// \effects Sets whether or not the file is preprocessed in-process.
+    /// Default value is `false`.
+    /// \notes The in-process preprocessor doesn't invoke the `clang++` binary,
+    /// instead the file is parsed as is and macros, includes and comments are extracted from the
+    /// raw file and libclang's preprocessing record.
+    /// This saves spawning one or two processes per file,
+    /// but macro invocations are not expanded in the tokens cppast sees,
+    /// so entities whose declaration depends on a macro might be parsed incorrectly.
+    /// \notes If this option is `true`, [*fast_preprocessing]() has no effect.
+    void in_process_preprocessing(bool b) noexcept
+    {
+        in_process_preprocessing_ = b;
+    }
+
+    /// \effects Sets whether or not `clang` skips the bodies of function definitions.
+    /// Default value is `false`.
+    /// \notes cppast does not need the bodies, skipping them makes parsing of files with many
+    /// inline functions a lot faster.
+    /// The functions are still reported as definitions.
+    /// \notes `clang` always parses the bodies of `constexpr` functions and functions with a
+    /// deduced return type, as they are needed to determine the type.
+    void skip_function_bodies(bool b) noexcept
+    {
+        skip_function_bodies_ = b;
+    }
+
 private:
     void do_set_flags(cpp_standard standard, compile_flags flags) override;
 
@@ -174,6 +235,8 @@ private:
     bool        write_preprocessed_ : 1;
     bool        fast_preprocessing_ : 1;
     bool        remove_comments_in_macro_ : 1;
+    bool        in_process_preprocessing_ : 1;
+    bool        skip_function_bodies_ : 1;
 
     friend detail::libclang_compile_config_access;
 };
@@ -206,6 +269,53 @@ public:
 
     ~libclang_parser() noexcept override;
 
+    /// \effects Sets whether the threads libclang creates while parsing run with background
+    /// priority. It is disabled by default.
+    /// \notes The parser uses a separate libclang index for each concurrent call to
+    /// [cppast::parser::parse](), the setting applies to all parses started afterwards.
+    void set_background_priority(bool value) noexcept;
+
+    /// \effects Sets whether the entities, types and expressions of a parsed file are allocated in
+    /// an arena owned by the [cppast::cpp_file](). It is disabled by default.
+    /// \notes Allocating an object is then just a pointer bump,
+    /// and destroying the file releases the memory at once instead of object by object.
+    /// The setting applies to all parses started afterwards.
+    void set_arena_allocation(bool value) noexcept;
+
+    /// \effects Sets whether structurally identical subtypes of the types in a parsed file are
+    /// shared, using a [cppast::cpp_type_context]() owned by the [cppast::cpp_file]().
+    /// It is disabled by default.
+    /// \notes Then a type like `const char` only exists once per file,
+    /// no matter how often `const char*` is used.
+    /// The user data of a shared type is shared as well, see [cppast::cpp_type::is_shared]().
+    /// The setting applies to all parses started afterwards.
+    void set_type_sharing(bool value) noexcept;
+
+    /// \effects Sets the maximum amount of memory in bytes used by retained translation units.
+    /// If it is not `0`, translation units are kept alive after parsing so [*reparse]() can reuse
+    /// them, and they are created with a precompiled preamble.
+    /// If the limit is exceeded, the least recently used translation units are discarded.
+    /// Default value is `0`, which disables retaining.
+    void retain_translation_units(std::size_t max_memory);
+
+    /// \effects Parses the file again, with the new contents instead of the ones on disk.
+    /// It reuses the translation unit retained by a previous call to
+    /// [cppast::parser::parse]() or `reparse()` for the same path,
+    /// so only the file itself needs to be parsed again, not the included headers.
+    /// \returns The [cppast::cpp_file]() object describing it, or `nullptr` on error.
+    /// The translation unit is retained again, even if the file couldn't be converted.
+    /// \throws [cppast::libclang_error]() if there is no retained translation unit for the file,
+    /// see [*retain_translation_units](), or if libclang failed to reparse it.
+    /// In the latter case, the translation unit is discarded.
+    /// \requires The index must not contain the entities of a previous parse of the same file.
+    /// \notes The new contents are always preprocessed in-process,
+    /// see [cppast::libclang_compile_config::in_process_preprocessing]().
+    /// \notes This function is thread safe.
+    /// Concurrent reparses of the same file wait for each other,
+    /// as do a reparse and a parse of it.
+    std::unique_ptr<cpp_file> reparse(const cpp_entity_index& idx, const std::string& path,
+                                      const std::string& new_contents) const;
+
 private:
     std::unique_ptr<cpp_file> do_parse(const cpp_entity_index& idx, std::string path,
                                        const compile_config& config) const override;
@@ -242,6 +352,7 @@ void parse_files(FileParser& parser, Range&& file_names,
 ///
 /// \effects For each file specified in a compilation database,
 /// uses the `FileParser` to parse the file with the configuration specified in the database.
+/// Each distinct configuration is only created once and shared by all files that use it.
 ///
 /// \requires `FileParser` must have the same requirements as for
 /// [cppast::parse_files](standardese://parse_files_basic/). It must also use the libclang parser,
@@ -253,14 +364,17 @@ void parse_database(FileParser& parser, const libclang_compilation_database& dat
                   "must use the libclang parser");
     struct data_t
     {
-        FileParser&                          parser;
-        const libclang_compilation_database& database;
-    } data{parser, database};
-    detail::for_each_file(database, &data, [](void* ptr, std::string file) {
-        auto& data = *static_cast<data_t*>(ptr);
-
-        libclang_compile_config config(data.database, file);
-        data.parser.parse(std::move(file), std::move(config));
+        FileParser&                                                parser;
+        const libclang_compilation_database&                       database;
+        std::vector<type_safe::optional<libclang_compile_config>> configs;
+    } data{parser, database, {}};
+    data.configs.resize(database.no_configurations());
+    detail::for_each_file(database, &data, [](void* ptr, std::string file, std::size_t index) {
+        auto& data   = *static_cast<data_t*>(ptr);
+        auto& config = data.configs[index];
+        if (!config)
+            config = libclang_compile_config(data.database, file);
+        data.parser.parse(std::move(file), config.value());
     });
 }
 } // namespace cppast
@@ -0,0 +1,306 @@
+// Copyright (C) 2017-2019 Jonathan Müller <jonathanmueller.dev@gmail.com>
+// This file is subject to the license terms in the LICENSE file
+// found in the top-level directory of this distribution.
+
+#ifndef CPPAST_MATCHER_HPP_INCLUDED
+#define CPPAST_MATCHER_HPP_INCLUDED
+
+#include <bitset>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <type_safe/optional_ref.hpp>
+
+#include <cppast/cpp_attribute.hpp>
+#include <cppast/cpp_entity.hpp>
+#include <cppast/cpp_entity_kind.hpp>
+#include <cppast/cpp_type.hpp>
+
+namespace cppast
+{
+/// \exclude
+namespace detail
+{
+    // the bound entities of a match, the ids are owned by the matchers
+    using match_bindings = std::vector<std::pair<const std::string*, const cpp_entity*>>;
+
+    using entity_kind_set = std::bitset<std::size_t(cpp_entity_kind::count)>;
+
+    class entity_matcher_node
+    {
+    public:
+        entity_matcher_node(const entity_matcher_node&) = delete;
+        entity_matcher_node& operator=(const entity_matcher_node&) = delete;
+
+        virtual ~entity_matcher_node() noexcept = default;
+
+        // if it returns false, the bindings are unchanged
+        bool matches(const cpp_entity& e, match_bindings& bindings) const
+        {
+            auto size   = bindings.size();
+            auto result = do_matches(e, bindings);
+            if (!result)
+                bindings.resize(size);
+            return result;
+        }
+
+        // all entities the matcher matches have one of those kinds
+        const entity_kind_set& kinds() const noexcept
+        {
+            return kinds_;
+        }
+
+    protected:
+        explicit entity_matcher_node(entity_kind_set kinds) : kinds_(kinds) {}
+
+    private:
+        virtual bool do_matches(const cpp_entity& e, match_bindings& bindings) const = 0;
+
+        entity_kind_set kinds_;
+    };
+
+    class type_matcher_node
+    {
+    public:
+        type_matcher_node() = default;
+
+        type_matcher_node(const type_matcher_node&) = delete;
+        type_matcher_node& operator=(const type_matcher_node&) = delete;
+
+        virtual ~type_matcher_node() noexcept = default;
+
+        virtual bool matches(const cpp_type& type) const = 0;
+    };
+
+    struct matcher_access;
+} // namespace detail
+
+/// A predicate on a [cppast::cpp_entity]() that can bind entities to names.
+///
+/// It is created by the functions in the `cppast::matchers` namespace
+/// and is cheap to copy.
+class entity_matcher
+{
+public:
+    /// \returns A matcher matching the same entities,
+    /// which binds the matched entity to the given id.
+    entity_matcher bind(std::string id) const;
+
+    /// \returns Whether or not the entity matches.
+    bool matches(const cpp_entity& e) const;
+
+private:
+    explicit entity_matcher(std::shared_ptr<const detail::entity_matcher_node> node)
+    : node_(std::move(node))
+    {}
+
+    std::shared_ptr<const detail::entity_matcher_node> node_;
+
+    friend detail::matcher_access;
+};
+
+/// A predicate on a [cppast::cpp_type]().
+///
+/// It is created by the functions in the `cppast::matchers` namespace
+/// and is cheap to copy.
+class type_matcher
+{
+public:
+    /// \returns Whether or not the type matches.
+    bool matches(const cpp_type& type) const
+    {
+        return node_->matches(type);
+    }
+
+private:
+    explicit type_matcher(std::shared_ptr<const detail::type_matcher_node> node)
+    : node_(std::move(node))
+    {}
+
+    std::shared_ptr<const detail::type_matcher_node> node_;
+
+    friend detail::matcher_access;
+};
+
+/// \exclude
+namespace detail
+{
+    entity_matcher make_all_of(std::vector<entity_matcher> matchers);
+    entity_matcher make_any_of(std::vector<entity_matcher> matchers);
+
+    type_matcher make_all_of(std::vector<type_matcher> matchers);
+    type_matcher make_any_of(std::vector<type_matcher> matchers);
+} // namespace detail
+
+/// Functions creating [cppast::entity_matcher]() and [cppast::type_matcher]() objects.
+namespace matchers
+{
+    /// \returns A matcher matching all entities.
+    entity_matcher any_entity();
+
+    /// \returns A matcher matching all entities of the given kind.
+    entity_matcher is_kind(cpp_entity_kind kind);
+
+    /// \returns A matcher matching all entities with the given name.
+    entity_matcher has_name(std::string name);
+
+    /// \returns A matcher matching all entities having an attribute
+    /// of the given name (1)/kind (2).
+    /// \group has_attribute
+    entity_matcher has_attribute(std::string name);
+
+    /// \group has_attribute
+    entity_matcher has_attribute(cpp_attribute_kind kind);
+
+    /// \returns A matcher matching all entities whose parent matches the given matcher.
+    entity_matcher has_parent(entity_matcher parent);
+
+    /// \returns A matcher matching all entities where one of the ancestors matches the given
+    /// matcher. The innermost matching ancestor is bound.
+    entity_matcher has_ancestor(entity_matcher ancestor);
+
+    /// \returns A matcher matching all entities with a type that matches the given matcher.
+    /// \notes The type of a variable, member variable, bitfield or function parameter is its type,
+    /// the type of an alias is the aliased type,
+    /// and the type of a function, member function or conversion operator is the return type.
+    entity_matcher has_type(type_matcher type);
+
+    /// \returns A matcher matching all entities that match all of the given matchers.
+    /// \group all_of
+    template <typename... Matchers>
+    entity_matcher all_of(entity_matcher first, Matchers... rest)
+    {
+        return detail::make_all_of({std::move(first), std::move(rest)...});
+    }
+
+    /// \returns A matcher matching all entities that match one of the given matchers.
+    /// The bindings are the ones of the first matcher that matches.
+    /// \group any_of
+    template <typename... Matchers>
+    entity_matcher any_of(entity_matcher first, Matchers... rest)
+    {
+        return detail::make_any_of({std::move(first), std::move(rest)...});
+    }
+
+    /// \returns A matcher matching all entities that don't match the given matcher.
+    /// It never binds anything.
+    /// \group unless
+    entity_matcher unless(entity_matcher matcher);
+
+    /// \returns A matcher matching all types.
+    type_matcher any_type();
+
+    /// \returns A matcher matching all types of the given kind.
+    type_matcher is_type_kind(cpp_type_kind kind);
+
+    /// \returns A matcher matching the builtin type of the given kind.
+    type_matcher is_builtin(cpp_builtin_type_kind kind);
+
+    /// \returns A matcher matching all types whose spelling,
+    /// as given by [cppast::to_string(const cpp_type&)](), is the given string.
+    type_matcher has_spelling(std::string spelling);
+
+    /// \returns A matcher matching all `const` qualified types.
+    type_matcher is_const();
+
+    /// \returns A matcher matching all types that match the given matcher,
+    /// after removing top-level cv qualifiers.
+    type_matcher ignoring_cv(type_matcher type);
+
+    /// \returns A matcher matching all pointer types whose pointee matches the given matcher.
+    type_matcher points_to(type_matcher pointee);
+
+    /// \returns A matcher matching all reference types whose referee matches the given matcher.
+    type_matcher references(type_matcher referee);
+
+    /// \group all_of
+    template <typename... Matchers>
+    type_matcher all_of(type_matcher first, Matchers... rest)
+    {
+        return detail::make_all_of({std::move(first), std::move(rest)...});
+    }
+
+    /// \group any_of
+    template <typename... Matchers>
+    type_matcher any_of(type_matcher first, Matchers... rest)
+    {
+        return detail::make_any_of({std::move(first), std::move(rest)...});
+    }
+
+    /// \group unless
+    type_matcher unless(type_matcher matcher);
+} // namespace matchers
+
+/// A successful match of a [cppast::entity_matcher]().
+///
+/// It refers to the bindings stored in the [cppast::match_finder]() during the traversal,
+/// so it is only valid during the callback it is passed to and must not be stored.
+class match_result
+{
+public:
+    /// \returns The entity that was matched.
+    const cpp_entity& entity() const noexcept
+    {
+        return *entity_;
+    }
+
+    /// \returns The entity bound to the given id, if there is any.
+    type_safe::optional_ref<const cpp_entity> get(const std::string& id) const noexcept;
+
+private:
+    match_result(const cpp_entity& e, const detail::match_bindings& bindings)
+    : entity_(&e), bindings_(&bindings)
+    {}
+
+    const cpp_entity*             entity_;
+    const detail::match_bindings* bindings_;
+
+    friend class match_finder;
+};
+
+/// Runs multiple [cppast::entity_matcher]() objects in a single traversal.
+///
+/// Every matcher knows the entity kinds it can match,
+/// so the finder groups them by kind and only evaluates the relevant ones for every entity.
+/// Running many matchers thus costs little more than a single [cppast::visit]().
+class match_finder
+{
+public:
+    /// The callback invoked for every match.
+    using callback = std::function<void(const match_result&)>;
+
+    /// \effects Registers a matcher with the callback that is invoked for every entity it matches.
+    /// If an exception is thrown, the finder is unchanged.
+    void add(entity_matcher matcher, callback cb);
+
+    /// \effects Traverses the entity and all of its children, as visited by [cppast::visit](),
+    /// and invokes the callback of every matcher that matches one of them.
+    /// For an entity, the callbacks are invoked in the order the matchers were added.
+    void match(const cpp_entity& e) const;
+
+    /// \returns The number of registered matchers.
+    std::size_t size() const noexcept
+    {
+        return queries_.size();
+    }
+
+private:
+    struct query
+    {
+        entity_matcher matcher;
+        callback       cb;
+
+        query(entity_matcher matcher, callback cb) : matcher(std::move(matcher)), cb(std::move(cb))
+        {}
+    };
+
+    std::vector<query>       queries_;
+    std::vector<std::size_t> by_kind_[std::size_t(cpp_entity_kind::count)];
+};
+} // namespace cppast
+
+#endif // CPPAST_MATCHER_HPP_INCLUDED
@@ -0,0 +1,128 @@
+// Copyright (C) 2017-2019 Jonathan Müller <jonathanmueller.dev@gmail.com>
+// This file is subject to the license terms in the LICENSE file
+// found in the top-level directory of this distribution.
+
+#ifndef CPPAST_PARALLEL_VISITOR_HPP_INCLUDED
+#define CPPAST_PARALLEL_VISITOR_HPP_INCLUDED
+
+#include <cstddef>
+#include <vector>
+
+#include <cppast/detail/thread_pool.hpp>
+#include <cppast/parser.hpp>
+#include <cppast/visitor.hpp>
+
+namespace cppast
+{
+/// Options controlling [cppast::parallel_visit]().
+struct parallel_visit_options
+{
+    /// The number of worker threads, one per hardware thread by default.
+    cppast::worker_count workers = worker_count::hardware();
+
+    /// Whether or not the children of files, namespaces and language linkage specifications
+    /// are visited as separate tasks.
+    ///
+    /// If `false`, every entity of the range is visited by a single task.
+    /// If `true`, the callback only gets the enter event of such a container,
+    /// if it returns `true`, every child is scheduled as a new task.
+    /// The exit event of the container is never reported.
+    bool split_namespaces = false;
+};
+
+/// \exclude
+namespace detail
+{
+    void parallel_visit(thread_pool& pool, const cpp_entity& e, visitor_callback_t cb,
+                        void* functor, bool split_namespaces);
+
+    inline const cpp_entity& get_visit_entity(const cpp_entity& e) noexcept
+    {
+        return e;
+    }
+
+    template <typename Ptr>
+    auto get_visit_entity(const Ptr& ptr) noexcept
+        -> decltype(static_cast<const cpp_entity&>(*ptr))
+    {
+        return *ptr;
+    }
+
+    // the state of a single thread in parallel_visit_reduce(),
+    // the padding keeps the states of different threads on different cache lines
+    template <typename T>
+    struct reduce_slot
+    {
+        T    value;
+        char padding[64];
+
+        explicit reduce_slot(const T& value) : value(value), padding() {}
+    };
+
+    template <typename Range, typename Func>
+    void parallel_visit_range(thread_pool& pool, const Range& entities, Func& f,
+                              bool split_namespaces)
+    {
+        for (auto& cur : entities)
+            parallel_visit(pool, get_visit_entity(cur), get_visitor_callback<Func>(), &f,
+                           split_namespaces);
+        pool.wait();
+    }
+} // namespace detail
+
+/// Visits a range of entities, like files, in parallel using a work-stealing thread pool.
+///
+/// \effects Every entity of the range is visited as if by [cppast::visit](),
+/// but the subtrees are visited in parallel, see [cppast::parallel_visit_options]().
+/// The callback sees the entities of a single subtree in the same order as [cppast::visit](),
+/// but there is no order between different subtrees.
+/// If the callback returns `false` to abort, only the visit of the current subtree is aborted.
+/// \requires The range must contain [cppast::cpp_entity]() objects, or pointers to them,
+/// and `f` must be callable as specified for [cppast::visit]().
+/// It is called concurrently from multiple threads, so it must be thread safe.
+/// \throws The first exception thrown by `f`, after all other subtrees have been visited.
+/// \notes The AST and the [cppast::cpp_entity_index]() are only accessed through `const`,
+/// which is thread safe, but they must not be modified during the visit.
+template <typename Range, typename Func>
+void parallel_visit(const Range& entities, Func f, const parallel_visit_options& options = {})
+{
+    detail::thread_pool pool(options.workers.value);
+    detail::parallel_visit_range(pool, entities, f, options.split_namespaces);
+}
+
+/// Visits a range of entities in parallel and combines per-thread results.
+///
+/// \effects Like [cppast::parallel_visit](), but every thread has its own copy of `init`,
+/// which is passed to `f` as first argument.
+/// It must be callable as `f(T& local, const cpp_entity& e, const visitor_info& info)`,
+/// the return value is treated like for [cppast::visit]().
+/// After the visit, all copies are combined by calling `combine(result, local)`,
+/// which must return the new result.
+/// \returns The combined result.
+/// \requires `init` must be the identity of `combine`.
+/// \notes As every thread has its own state, `f` doesn't need to synchronize access to it.
+template <typename T, typename Range, typename Func, typename Combine>
+T parallel_visit_reduce(const Range& entities, T init, Func f, Combine combine,
+                        const parallel_visit_options& options = {})
+{
+    auto no_workers = options.workers.value == 0u ? detail::thread_pool::default_size()
+                                                  : options.workers.value;
+
+    // one state for every worker and one for the thread waiting on them,
+    // declared before the pool, so it outlives all tasks
+    std::vector<detail::reduce_slot<T>> locals(no_workers + 1u, detail::reduce_slot<T>(init));
+
+    detail::thread_pool pool(no_workers);
+    auto                visitor = [&](const cpp_entity& e, const visitor_info& info) {
+        return f(locals[pool.current_worker()].value, e, info);
+    };
+    detail::parallel_visit_range(pool, entities, visitor, options.split_namespaces);
+
+    T result = std::move(init);
+    for (auto& local : locals)
+        result = combine(std::move(result), local.value);
+    return result;
+}
+} // namespace cppast
+
+#endif // CPPAST_PARALLEL_VISITOR_HPP_INCLUDED
@@ -6,10 +6,12 @@
 #define CPPAST_PARSER_HPP_INCLUDED
 
 #include <atomic>
+#include <deque>
 
 #include <cppast/compile_config.hpp>
 #include <cppast/cpp_file.hpp>
 #include <cppast/cpp_preprocessor.hpp>
+#include <cppast/detail/thread_pool.hpp>
 #include <cppast/diagnostic.hpp>
 #include <cppast/diagnostic_logger.hpp>
 
@@ -89,7 +91,7 @@ private:
 
 /// A simple `FileParser` that parses all files synchronously.
 ///
-/// More advanced parsers could use a thread pool, for example.
+/// See [cppast::parallel_file_parser]() for a `FileParser` using a thread pool.
 template <class Parser>
 class simple_file_parser
 {
@@ -139,6 +141,7 @@ public:
     }
 
     /// \returns An iteratable object iterating over all the files that have been parsed so far.
+    /// \notes Parsing another file doesn't invalidate its iterators.
     /// \exclude return
     detail::iteratable_intrusive_list<cpp_file> files() const noexcept
     {
@@ -151,6 +154,169 @@ private:
     type_safe::object_ref<const cpp_entity_index> idx_;
 };
 
+/// The number of worker threads used by a [cppast::parallel_file_parser]().
+struct worker_count
+{
+    unsigned value;
+
+    /// \effects Sets the number of workers,
+    /// zero means one worker per hardware thread.
+    explicit worker_count(unsigned value) noexcept : value(value) {}
+
+    /// \returns A worker count that uses one worker per hardware thread.
+    static worker_count hardware() noexcept
+    {
+        return worker_count(0u);
+    }
+};
+
+/// A `FileParser` that parses all files in parallel using a work-stealing thread pool.
+///
+/// `parse()` only schedules the file, the parsing itself happens asynchronously.
+/// The parsed files are stored in the order they were scheduled in,
+/// regardless of the order they have finished in,
+/// so the result is the same as with a [cppast::simple_file_parser]().
+///
+/// It can be used with [cppast::parse_files](standardese://parse_files_basic/),
+/// [cppast::parse_database]() and [cppast::resolve_includes]().
+/// \notes The `Parser` must be thread safe, as required by [cppast::parser](),
+/// and so must the [cppast::diagnostic_logger]() it uses.
+template <class Parser>
+class parallel_file_parser
+{
+    static_assert(std::is_base_of<cppast::parser, Parser>::value,
+                  "Parser must be derived from cppast::parser");
+
+public:
+    using parser = Parser;
+    using config = typename Parser::config;
+
+    /// \effects Creates a file parser populating the given index
+    /// and using the parser created by forwarding the given arguments.
+    /// It uses one worker per hardware thread.
+    template <typename... Args>
+    explicit parallel_file_parser(type_safe::object_ref<const cpp_entity_index> idx,
+                                  Args&&... args)
+    : parallel_file_parser(idx, worker_count::hardware(), std::forward<Args>(args)...)
+    {}
+
+    /// \effects Creates a file parser populating the given index
+    /// and using the parser created by forwarding the given arguments.
+    /// It uses the given number of workers.
+    template <typename... Args>
+    explicit parallel_file_parser(type_safe::object_ref<const cpp_entity_index> idx,
+                                  worker_count workers, Args&&... args)
+    : parser_(std::forward<Args>(args)...), idx_(idx), pool_(workers.value)
+    {}
+
+    parallel_file_parser(const parallel_file_parser&) = delete;
+    parallel_file_parser& operator=(const parallel_file_parser&) = delete;
+
+    /// \effects Waits for all scheduled files to be parsed.
+    ~parallel_file_parser() noexcept
+    {
+        try
+        {
+            pool_.wait();
+        }
+        catch (...)
+        {}
+    }
+
+    /// \effects Schedules parsing of the given file using the given configuration.
+    /// The path and configuration are copied.
+    /// \notes The file is not parsed yet when the function returns,
+    /// call [*wait]() or [*files]() to get the result.
+    void parse(std::string path, config c)
+    {
+        pending_.emplace_back();
+        auto result = &pending_.back();
+
+        auto task = std::make_shared<parse_task>(std::move(path), std::move(c));
+        pool_.submit([this, task, result] {
+            parser_.logger().log("parallel file parser",
+                                 diagnostic{"parsing file '" + task->path + "'", source_location(),
+                                            severity::info});
+            *result = parser_.parse(*idx_, std::move(task->path), task->c);
+        });
+    }
+
+    /// \effects Blocks until all scheduled files have been parsed,
+    /// and adds the results to [*files]() in the order they were scheduled in.
+    /// \throws Any exception thrown while parsing, the other files are still parsed.
+    void wait() const
+    {
+        std::exception_ptr exception;
+        try
+        {
+            pool_.wait();
+        }
+        catch (...)
+        {
+            exception = std::current_exception();
+        }
+
+        for (auto& file : pending_)
+            if (file)
+                files_.push_back(std::move(file));
+        pending_.clear();
+
+        if (exception)
+            std::rethrow_exception(exception);
+    }
+
+    /// \returns The result of [cppast::parser::error]().
+    /// \notes Only files that have already been parsed are considered,
+    /// call [*wait]() first.
+    bool error() const noexcept
+    {
+        return parser_.error();
+    }
+
+    /// \effects Calls [cppast::parser::reset_error]().
+    void reset_error() noexcept
+    {
+        parser_.reset_error();
+    }
+
+    /// \returns The index that is being populated.
+    const cpp_entity_index& index() const noexcept
+    {
+        return *idx_;
+    }
+
+    /// \returns The number of worker threads.
+    unsigned no_workers() const noexcept
+    {
+        return pool_.size();
+    }
+
+    /// \effects Calls [*wait]().
+    /// \returns An iteratable object iterating over all the files that have been parsed so far.
+    /// \notes Calling [*wait]() or [*files]() again doesn't invalidate its iterators.
+    /// \exclude return
+    detail::iteratable_intrusive_list<cpp_file> files() const
+    {
+        wait();
+        return type_safe::cref(files_);
+    }
+
+private:
+    struct parse_task
+    {
+        std::string path;
+        config      c;
+
+        parse_task(std::string path, config c) : path(std::move(path)), c(std::move(c)) {}
+    };
+
+    Parser                                        parser_;
+    type_safe::object_ref<const cpp_entity_index> idx_;
+    mutable std::deque<std::unique_ptr<cpp_file>> pending_;
+    mutable detail::intrusive_list<cpp_file>      files_;
+    mutable detail::thread_pool                   pool_; // must be destroyed first
+};
+
 namespace detail
 {
     struct std_begin
@@ -5,7 +5,10 @@
 #ifndef CPPAST_VISITOR_HPP_INCLUDED
 #define CPPAST_VISITOR_HPP_INCLUDED
 
+#include <cstddef>
 #include <type_traits>
+#include <utility>
+#include <vector>
 
 #include <cppast/cpp_class.hpp>
 #include <cppast/cpp_entity.hpp>
@@ -125,6 +128,114 @@ void visit(const cpp_entity& e, Func f)
     detail::visit(e, detail::get_visitor_callback<Func>(), &f, cpp_public, false);
 }
 
+/// A cursor traversing a [cppast::cpp_entity]() and children without recursion.
+///
+/// It produces the same events as [cppast::visit]() in the same order,
+/// but the containers whose children are visited are kept on an explicit stack,
+/// so the call stack does not grow with the nesting depth of the AST.
+///
+/// ```cpp
+/// for (cppast::ast_cursor cursor(file); !cursor.done(); cursor.next())
+///     handle(cursor.entity(), cursor.info());
+/// ```
+class ast_cursor
+{
+public:
+    /// \effects Creates a cursor positioned at the first event of the given entity,
+    /// with the same initial [cppast::visitor_info]() as [cppast::visit]().
+    explicit ast_cursor(const cpp_entity& e) : ast_cursor(e, cpp_public, false) {}
+
+    /// \returns Whether or not there are no more events,
+    /// either because all of them were visited or the traversal was aborted.
+    bool done() const noexcept
+    {
+        return cur_ == nullptr;
+    }
+
+    /// \returns Whether or not the traversal was aborted.
+    bool aborted() const noexcept
+    {
+        return aborted_;
+    }
+
+    /// \returns The entity of the current event.
+    /// \requires `!done()`.
+    const cpp_entity& entity() const noexcept
+    {
+        return *cur_;
+    }
+
+    /// \returns The [cppast::visitor_info]() of the current event.
+    /// \requires `!done()`.
+    const visitor_info& info() const noexcept
+    {
+        return info_;
+    }
+
+    /// \returns The number of containers whose children are currently being visited.
+    std::size_t depth() const noexcept
+    {
+        return stack_.size();
+    }
+
+    /// \effects Moves to the next event,
+    /// which is the first child if the current event enters a container.
+    /// \requires `!done()`.
+    void next()
+    {
+        advance(continue_visit);
+    }
+
+    /// \effects Moves to the next event,
+    /// which is the exit event if the current event enters a container.
+    /// \requires `!done()`.
+    void skip_children()
+    {
+        advance(info_.event != visitor_info::container_entity_enter);
+    }
+
+    /// \effects Aborts the traversal, afterwards the cursor is done.
+    void abort() noexcept
+    {
+        cur_     = nullptr;
+        aborted_ = true;
+    }
+
+    /// \effects Moves to the next event,
+    /// interpreting the result like the return value of a visitor of [cppast::visit]().
+    /// \requires `!done()`.
+    void advance(bool result);
+
+private:
+    ast_cursor(const cpp_entity& e, cpp_access_specifier_kind access, bool last_child);
+
+    using get_child_t = const cpp_entity& (*)(const cpp_entity&, std::size_t);
+
+    // a container whose children are being visited
+    struct frame
+    {
+        const cpp_entity*         container;
+        get_child_t               get_child;
+        std::size_t               next, size;
+        cpp_access_specifier_kind access, child_access;
+        bool                      last_child;
+    };
+
+    void set_current(const cpp_entity& e, cpp_access_specifier_kind access, bool last_child);
+    void next_child();
+
+    std::vector<frame> stack_;
+    const cpp_entity*  cur_;
+    visitor_info       info_;
+    // the children of cur_, if it is a container
+    get_child_t get_child_;
+    std::size_t no_children_;
+    bool        aborted_;
+
+    friend bool detail::visit(const cpp_entity& e, detail::visitor_callback_t cb, void* functor,
+                              cpp_access_specifier_kind cur_access, bool last_child);
+};
+
 /// The result of a visitor filter operation.
 enum class visit_filter
 {
@@ -237,6 +348,106 @@ detail::visitor_filter_t whitelist()
         return detail::has_one_of_kind<Kinds...>(e) ? visit_filter::include : visit_filter::exclude;
     };
 }
+
+/// \exclude
+namespace detail
+{
+    template <typename... Funcs>
+    struct overloaded;
+
+    template <typename Func>
+    struct overloaded<Func> : Func
+    {
+        explicit overloaded(Func f) : Func(std::move(f)) {}
+
+        using Func::operator();
+    };
+
+    template <typename Func, typename... Tail>
+    struct overloaded<Func, Tail...> : Func, overloaded<Tail...>
+    {
+        explicit overloaded(Func f, Tail... tail)
+        : Func(std::move(f)), overloaded<Tail...>(std::move(tail)...)
+        {}
+
+        using Func::operator();
+        using overloaded<Tail...>::operator();
+    };
+
+    template <typename Func>
+    using static_visit_result
+        = decltype(std::declval<Func&>()(std::declval<const cpp_entity&>()));
+
+    template <typename Func, typename T>
+    static_visit_result<Func> static_visit_handler(Func& f, const cpp_entity& e)
+    {
+        return f(static_cast<const T&>(e));
+    }
+
+    // the handlers for all entity kinds, indexed by the kind
+    // T::kind() isn't constexpr, so it is filled on first use
+    template <typename Func, typename... Entities>
+    class static_visit_table
+    {
+    public:
+        using handler = static_visit_result<Func> (*)(Func&, const cpp_entity&);
+
+        static const static_visit_table& get()
+        {
+            static const static_visit_table table;
+            return table;
+        }
+
+        handler operator[](cpp_entity_kind kind) const noexcept
+        {
+            return handlers_[std::size_t(kind)];
+        }
+
+    private:
+        static_visit_table() noexcept
+        {
+            static_assert(sizeof...(Entities) > 0, "At least one entity type must be specified");
+            for (auto& h : handlers_)
+                h = &static_visit_handler<Func, cpp_entity>;
+
+            // poor men's fold
+            int dummy[]{(handlers_[std::size_t(Entities::kind())]
+                         = &static_visit_handler<Func, Entities>,
+                         0)...};
+            (void)dummy;
+        }
+
+        handler handlers_[std::size_t(cpp_entity_kind::count)];
+    };
+} // namespace detail
+
+/// \returns A function object that has the call operators of all the given function objects.
+/// \notes Use it to combine the handlers for [cppast::static_visit]().
+template <typename... Funcs>
+detail::overloaded<typename std::decay<Funcs>::type...> overload(Funcs&&... funcs)
+{
+    return detail::overloaded<typename std::decay<Funcs>::type...>(std::forward<Funcs>(funcs)...);
+}
+
+/// Calls a function with an entity converted to its derived class.
+///
+/// \effects If the kind of the entity is the kind of one of the `Entities`,
+/// invokes `f` with a reference to the entity converted to that class.
+/// Otherwise, invokes `f` with the [cppast::cpp_entity]() itself.
+/// \returns The result of the invocation.
+/// \requires `Entities` must be classes derived from [cppast::cpp_entity]() with a static `kind()`
+/// function, and `f` must be callable with each of them and with [cppast::cpp_entity]().
+/// \notes Dispatching is a single lookup in a table of handlers generated for `Func` and
+/// `Entities`, it doesn't need a chain of comparisons or `dynamic_cast`.
+/// The function is called directly, without type erasure.
+template <typename... Entities, typename Func>
+detail::static_visit_result<typename std::remove_reference<Func>::type> static_visit(
+    const cpp_entity& e, Func&& f)
+{
+    using table = detail::static_visit_table<typename std::remove_reference<Func>::type,
+                                             Entities...>;
+    return table::get()[e.kind()](f, e);
+}
 } // namespace cppast
 
 #endif // CPPAST_VISITOR_HPP_INCLUDED
@@ -0,0 +1,156 @@
+// Copyright (C) 2017-2019 Jonathan Müller <jonathanmueller.dev@gmail.com>
+// This file is subject to the license terms in the LICENSE file
+// found in the top-level directory of this distribution.
+
+#include <cppast/detail/arena.hpp>
+
+#include <atomic>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <new>
+
+using namespace cppast;
+
+namespace
+{
+constexpr std::size_t max_alignment = alignof(std::max_align_t);
+
+constexpr std::size_t round_up(std::size_t size) noexcept
+{
+    return (size + max_alignment - 1u) / max_alignment * max_alignment;
+}
+
+constexpr std::size_t min_block_size = 16u * 1024u;
+constexpr std::size_t max_block_size = 1024u * 1024u;
+
+thread_local detail::arena* current_arena = nullptr;
+
+// the memory blocks of all arenas,
+// so deallocate_node() can tell whether a node is in an arena without storing anything in it
+class block_registry
+{
+public:
+    static block_registry& get()
+    {
+        static block_registry registry;
+        return registry;
+    }
+
+    void insert(const char* begin, const char* end)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        blocks_.emplace(begin, end);
+        ++no_blocks_;
+    }
+
+    void erase(const char* begin) noexcept
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        blocks_.erase(begin);
+        --no_blocks_;
+    }
+
+    bool contains(const void* ptr) noexcept
+    {
+        // fast path: if no arena is in use, all nodes are on the heap
+        if (no_blocks_ == 0u)
+            return false;
+
+        auto address = static_cast<const char*>(ptr);
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        // the last block starting at or before the address
+        auto iter = blocks_.upper_bound(address);
+        if (iter == blocks_.begin())
+            return false;
+        --iter;
+        return std::less<const char*>()(address, iter->second);
+    }
+
+private:
+    block_registry() : no_blocks_(0u) {}
+
+    std::mutex                         mutex_;
+    std::map<const char*, const char*> blocks_; // begin -> end
+    std::atomic<std::size_t>           no_blocks_;
+};
+} // namespace
+
+struct detail::arena::block
+{
+    block*      next;
+    std::size_t size;
+};
+
+detail::arena::arena() noexcept
+: head_(nullptr), cur_(nullptr), end_(nullptr), no_allocations_(0u), capacity_(0u)
+{}
+
+detail::arena::~arena() noexcept
+{
+    while (head_)
+    {
+        auto next = head_->next;
+        block_registry::get().erase(reinterpret_cast<const char*>(head_));
+        ::operator delete(head_);
+        head_ = next;
+    }
+}
+
+void* detail::arena::allocate(std::size_t size)
+{
+    size = round_up(size);
+    if (size > std::size_t(end_ - cur_))
+    {
+        // blocks get bigger, so big files don't need too many
+        auto block_size = head_ ? 2u * head_->size : min_block_size;
+        if (block_size > max_block_size)
+            block_size = max_block_size;
+        if (block_size < size)
+            block_size = size;
+
+        auto memory = static_cast<char*>(::operator new(round_up(sizeof(block)) + block_size));
+        try
+        {
+            block_registry::get().insert(memory, memory + round_up(sizeof(block)) + block_size);
+        }
+        catch (...)
+        {
+            ::operator delete(memory);
+            throw;
+        }
+
+        head_ = ::new (memory) block{head_, block_size};
+        cur_  = memory + round_up(sizeof(block));
+        end_  = cur_ + block_size;
+        capacity_ += block_size;
+    }
+
+    auto result = cur_;
+    cur_ += size;
+    ++no_allocations_;
+    return result;
+}
+
+detail::arena_scope::arena_scope(arena* a) noexcept : previous_(current_arena)
+{
+    current_arena = a;
+}
+
+detail::arena_scope::~arena_scope() noexcept
+{
+    current_arena = previous_;
+}
+
+void* detail::allocate_node(std::size_t size)
+{
+    return current_arena ? current_arena->allocate(size) : ::operator new(size);
+}
+
+void detail::deallocate_node(void* ptr) noexcept
+{
+    // memory in an arena is released together with the arena
+    if (ptr && !block_registry::get().contains(ptr))
+        ::operator delete(ptr);
+}
@@ -46,13 +46,26 @@ cpp_attribute::cpp_attribute(cpp_attribute_kind                    kind,
     kind_ = kind;
 }
 
+namespace
+{
+// name == scope + "::" + attribute_name, without creating a new string
+bool is_scoped_name(const std::string& name, const std::string& scope,
+                    const std::string& attribute_name)
+{
+    return name.size() == scope.size() + 2u + attribute_name.size()
+           && name.compare(0u, scope.size(), scope) == 0
+           && name.compare(scope.size(), 2u, "::") == 0
+           && name.compare(scope.size() + 2u, std::string::npos, attribute_name) == 0;
+}
+} // namespace
+
 type_safe::optional_ref<const cpp_attribute> cppast::has_attribute(
     const cpp_attribute_list& attributes, const std::string& name)
 {
     auto iter
         = std::find_if(attributes.begin(), attributes.end(), [&](const cpp_attribute& attribute) {
               if (attribute.scope())
-                  return attribute.scope().value() + "::" + attribute.name() == name;
+                  return is_scoped_name(name, attribute.scope().value(), attribute.name());
               else
                   return attribute.name() == name;
           });
@@ -15,13 +15,75 @@ cpp_entity_index::duplicate_definition_error::duplicate_definition_error()
 : std::logic_error("duplicate registration of entity definition")
 {}
 
+cpp_entity_index::frozen_error::frozen_error()
+: std::logic_error("registration of entity in frozen index")
+{}
+
+cpp_entity_index::shard& cpp_entity_index::get_shard(const cpp_entity_id& id) const noexcept
+{
+    // the id is already a hash, but the lower bits are used for the buckets of the maps
+    auto hash = static_cast<detail::hash_type>(id);
+    return shards_[std::size_t(hash >> 32u) % shards_.size()];
+}
+
+void cpp_entity_index::namespace_list::push_back(type_safe::object_ref<const cpp_namespace> ns)
+{
+    if (blocks_.empty() || blocks_.back().size() == blocks_.back().capacity())
+    {
+        // never reallocate a block, a lookup might still refer to it
+        std::vector<type_safe::object_ref<const cpp_namespace>> block;
+        block.reserve(blocks_.empty() ? 4u : 2u * blocks_.back().size());
+        if (!blocks_.empty())
+            block.insert(block.end(), blocks_.back().begin(), blocks_.back().end());
+        blocks_.push_back(std::move(block));
+    }
+    blocks_.back().push_back(ns);
+}
+
+void cpp_entity_index::check_not_frozen() const
+{
+    if (is_frozen())
+        throw frozen_error();
+}
+
+namespace
+{
+// smallest power of two that is at least twice as big as size
+std::size_t get_table_size(std::size_t size) noexcept
+{
+    std::size_t result = 1u;
+    while (result < 2u * size)
+        result *= 2u;
+    return result;
+}
+
+// the first slot in the table where the id is stored or where it would be inserted
+template <typename T, typename Predicate>
+const T& probe(const std::vector<T>& table, detail::hash_type id, Predicate is_empty) noexcept
+{
+    auto mask = table.size() - 1u;
+    for (auto i = std::size_t(id) & mask;; i = (i + 1u) & mask)
+        if (table[i].id == id || is_empty(table[i]))
+            return table[i];
+}
+
+template <typename T, typename Predicate>
+T& probe(std::vector<T>& table, detail::hash_type id, Predicate is_empty) noexcept
+{
+    return const_cast<T&>(probe(static_cast<const std::vector<T>&>(table), id, is_empty));
+}
+} // namespace
+
 void cpp_entity_index::register_definition(cpp_entity_id                           id,
                                            type_safe::object_ref<const cpp_entity> entity) const
 {
     DEBUG_ASSERT(entity->kind() != cpp_entity_kind::namespace_t,
                  detail::precondition_error_handler{}, "must not be a namespace");
-    std::lock_guard<std::mutex> lock(mutex_);
-    auto                        result = map_.emplace(std::move(id), value(entity, true));
+    check_not_frozen();
+
+    auto&                       shard = get_shard(id);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto                        result = shard.map.emplace(std::move(id), value(entity, true));
     if (!result.second)
     {
         // already in map, override declaration
@@ -38,30 +100,47 @@ void cpp_entity_index::register_definition(cpp_entity_id
 bool cpp_entity_index::register_file(cpp_entity_id                         id,
                                      type_safe::object_ref<const cpp_file> file) const
 {
-    std::lock_guard<std::mutex> lock(mutex_);
-    return map_.emplace(std::move(id), value(file, true)).second;
+    check_not_frozen();
+
+    auto&                       shard = get_shard(id);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    return shard.map.emplace(std::move(id), value(file, true)).second;
 }
 
 void cpp_entity_index::register_forward_declaration(
     cpp_entity_id id, type_safe::object_ref<const cpp_entity> entity) const
 {
-    std::lock_guard<std::mutex> lock(mutex_);
-    map_.emplace(std::move(id), value(entity, false));
+    check_not_frozen();
+
+    auto&                       shard = get_shard(id);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    shard.map.emplace(std::move(id), value(entity, false));
 }
 
 void cpp_entity_index::register_namespace(cpp_entity_id                              id,
                                           type_safe::object_ref<const cpp_namespace> ns) const
 {
-    std::lock_guard<std::mutex> lock(mutex_);
-    ns_[std::move(id)].push_back(ns);
+    check_not_frozen();
+
+    auto&                       shard = get_shard(id);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    shard.ns[std::move(id)].push_back(ns);
 }
 
 type_safe::optional_ref<const cpp_entity> cpp_entity_index::lookup(
     const cpp_entity_id& id) const noexcept
 {
-    std::lock_guard<std::mutex> lock(mutex_);
-    auto                        iter = map_.find(id);
-    if (iter == map_.end())
+    if (is_frozen())
+    {
+        auto& value = probe(frozen_map_, static_cast<detail::hash_type>(id),
+                            [](const frozen_value& v) { return v.entity == nullptr; });
+        return type_safe::opt_ref(value.entity);
+    }
+
+    auto&                       shard = get_shard(id);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto                        iter = shard.map.find(id);
+    if (iter == shard.map.end())
         return {};
     return type_safe::ref(iter->second.entity.get());
 }
@@ -69,9 +148,19 @@ type_safe::optional_ref<const cpp_entity> cpp_entity_index::lookup(
 type_safe::optional_ref<const cpp_entity> cpp_entity_index::lookup_definition(
     const cpp_entity_id& id) const noexcept
 {
-    std::lock_guard<std::mutex> lock(mutex_);
-    auto                        iter = map_.find(id);
-    if (iter == map_.end() || !iter->second.is_definition)
+    if (is_frozen())
+    {
+        auto& value = probe(frozen_map_, static_cast<detail::hash_type>(id),
+                            [](const frozen_value& v) { return v.entity == nullptr; });
+        if (!value.is_definition)
+            return {};
+        return type_safe::opt_ref(value.entity);
+    }
+
+    auto&                       shard = get_shard(id);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto                        iter = shard.map.find(id);
+    if (iter == shard.map.end() || !iter->second.is_definition)
         return {};
     return type_safe::ref(iter->second.entity.get());
 }
@@ -79,10 +168,61 @@ type_safe::optional_ref<const cpp_entity> cpp_entity_index::lookup_definition(
 auto cpp_entity_index::lookup_namespace(const cpp_entity_id& id) const noexcept
     -> type_safe::array_ref<type_safe::object_ref<const cpp_namespace>>
 {
-    std::lock_guard<std::mutex> lock(mutex_);
-    auto                        iter = ns_.find(id);
-    if (iter == ns_.end())
+    if (is_frozen())
+    {
+        auto& namespaces = probe(frozen_ns_, static_cast<detail::hash_type>(id),
+                                 [](const frozen_namespaces& ns) { return ns.size == 0u; });
+        if (namespaces.size == 0u)
+            return nullptr;
+        return type_safe::ref(namespaces.data, namespaces.size);
+    }
+
+    auto&                       shard = get_shard(id);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto                        iter = shard.ns.find(id);
+    if (iter == shard.ns.end())
         return nullptr;
-    auto& vec = iter->second;
-    return type_safe::ref(vec.data(), vec.size());
+    return iter->second.get();
+}
+
+void cpp_entity_index::freeze() const
+{
+    if (is_frozen())
+        return;
+
+    auto no_entities = std::size_t(0u), no_namespaces = std::size_t(0u);
+    for (auto& shard : shards_)
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        no_entities += shard.map.size();
+        no_namespaces += shard.ns.size();
+    }
+
+    frozen_map_.assign(get_table_size(no_entities), frozen_value{0u, nullptr, false});
+    frozen_ns_.assign(get_table_size(no_namespaces), frozen_namespaces{0u, nullptr, 0u});
+    for (auto& shard : shards_)
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        for (auto& pair : shard.map)
+        {
+            auto  id = static_cast<detail::hash_type>(pair.first);
+            auto& slot
+                = probe(frozen_map_, id, [](const frozen_value& v) { return v.entity == nullptr; });
+            slot = frozen_value{id, &pair.second.entity.get(), pair.second.is_definition};
+        }
+
+        for (auto& pair : shard.ns)
+        {
+            auto  id   = static_cast<detail::hash_type>(pair.first);
+            auto& slot = probe(frozen_ns_, id,
+                               [](const frozen_namespaces& ns) { return ns.size == 0u; });
+            auto namespaces = pair.second.get();
+            slot            = frozen_namespaces{id, namespaces.data(), namespaces.size()};
+        }
+
+        // the namespaces are kept, previously returned references must stay valid
+        shard.map.clear();
+    }
+
+    frozen_.store(true, std::memory_order_release);
 }
@@ -4,10 +4,35 @@
 
 #include <cppast/cpp_file.hpp>
 
+#include <algorithm>
+#include <iterator>
+#include <utility>
+
 #include <cppast/cpp_entity_kind.hpp>
+#include <cppast/visitor.hpp>
 
 using namespace cppast;
 
+struct cpp_file::kind_index
+{
+    struct entry
+    {
+        const cpp_entity* entity;
+        std::size_t       position; // in visit order
+    };
+
+    std::vector<entry> entities[std::size_t(cpp_entity_kind::count)];
+};
+
+cpp_file::cpp_file(std::string name) : cpp_entity(std::move(name)) {}
+
+cpp_file::~cpp_file() noexcept = default;
+
+const detail::arena* detail::cpp_file_access::get_arena(const cpp_file& file) noexcept
+{
+    return file.arena_.get();
+}
+
 cpp_entity_kind cpp_file::kind() noexcept
 {
     return cpp_entity_kind::file_t;
@@ -22,3 +47,49 @@ bool detail::cpp_file_ref_predicate::operator()(const cpp_entity& e)
 {
     return e.kind() == cpp_entity_kind::file_t;
 }
+
+const cpp_file::kind_index& cpp_file::get_kind_index() const
+{
+    std::call_once(kind_index_flag_, [&] {
+        std::unique_ptr<kind_index> index(new kind_index);
+
+        auto position = std::size_t(0);
+        visit(*this, [&](const cpp_entity& e, const visitor_info& info) {
+            if (info.is_new_entity())
+                index->entities[std::size_t(e.kind())].push_back({&e, position++});
+        });
+
+        kind_index_ = std::move(index);
+    });
+    return *kind_index_;
+}
+
+void detail::for_each_of_kind(const cpp_file& file, const cpp_entity_kind* kinds,
+                              std::size_t no_kinds, kind_callback_t cb, void* functor)
+{
+    auto& index = file.get_kind_index();
+
+    using iterator = std::vector<cpp_file::kind_index::entry>::const_iterator;
+    std::vector<std::pair<iterator, iterator>> ranges;
+    ranges.reserve(no_kinds);
+    for (auto i = 0u; i != no_kinds; ++i)
+    {
+        auto& entities = index.entities[std::size_t(kinds[i])];
+        if (!entities.empty() && std::find(kinds, kinds + i, kinds[i]) == kinds + i)
+            ranges.emplace_back(entities.begin(), entities.end());
+    }
+
+    // merge the entities of all kinds back into visit order,
+    // only a handful of kinds are requested, so a linear search for the next one is enough
+    while (!ranges.empty())
+    {
+        auto next = ranges.begin();
+        for (auto iter = std::next(next); iter != ranges.end(); ++iter)
+            if (iter->first->position < next->first->position)
+                next = iter;
+
+        cb(functor, *next->first->entity);
+        if (++next->first == next->second)
+            ranges.erase(next);
+    }
+}
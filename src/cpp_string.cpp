@@ -0,0 +1,47 @@
+// Copyright (C) 2017-2019 Jonathan Müller <jonathanmueller.dev@gmail.com>
+// This file is subject to the license terms in the LICENSE file
+// found in the top-level directory of this distribution.
+
+#include <cppast/cpp_string.hpp>
+
+#include <array>
+#include <mutex>
+#include <unordered_set>
+
+using namespace cppast;
+
+namespace
+{
+// the pool is split into shards by the hash,
+// so concurrent parsers rarely block each other
+struct shard
+{
+    std::mutex                      mutex;
+    std::unordered_set<std::string> strings;
+};
+
+using pool = std::array<shard, 32>;
+
+pool& get_pool()
+{
+    // never destroyed, so strings can be used during static destruction
+    static auto result = new pool;
+    return *result;
+}
+} // namespace
+
+const std::string* detail::intern_string(const std::string& str)
+{
+    auto  hash  = std::hash<std::string>()(str);
+    auto& shard = get_pool()[(hash >> 8u) % get_pool().size()];
+
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    // elements of an unordered_set are never moved
+    return &*shard.strings.insert(str).first;
+}
+
+const std::string* detail::empty_string() noexcept
+{
+    static const std::string* result = intern_string("");
+    return result;
+}
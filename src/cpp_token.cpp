@@ -15,8 +15,8 @@ using namespace cppast;
 
 void cpp_token_string::builder::unmunch()
 {
-    DEBUG_ASSERT(!tokens_.empty() && tokens_.back().spelling == ">>", detail::assert_handler{});
-    tokens_.back().spelling = ">";
+    DEBUG_ASSERT(!spellings_.empty() && spellings_.back() == ">>", detail::assert_handler{});
+    spellings_.back() = ">";
 }
 
 namespace
@@ -571,6 +571,17 @@ type_safe::optional<cpp_token> punctuation_token(const char*& ptr)
 }
 } // namespace
 
+cpp_token_string::cpp_token_string(const std::vector<cpp_token>& tokens)
+{
+    spellings_.reserve(tokens.size());
+    kinds_.reserve(tokens.size());
+    for (auto& token : tokens)
+    {
+        spellings_.push_back(token.spelling);
+        kinds_.push_back(static_cast<unsigned char>(token.kind));
+    }
+}
+
 cpp_token_string cpp_token_string::tokenize(std::string str)
 {
     cpp_token_string::builder builder;
@@ -605,24 +616,38 @@ bool is_identifier(char c)
 {
     return std::isalnum(c) || c == '_';
 }
+
+bool needs_whitespace(const std::string& prev, const std::string& cur) noexcept
+{
+    return !prev.empty() && is_identifier(prev.back()) && is_identifier(cur[0u]);
+}
 } // namespace
 
 std::string cpp_token_string::as_string() const
 {
+    // compute the size first, so there is only one allocation
+    auto size = std::size_t(0);
+    for (auto iter = spellings_.begin(); iter != spellings_.end(); ++iter)
+    {
+        DEBUG_ASSERT(!iter->empty(), detail::assert_handler{});
+        size += iter->size();
+        if (iter != spellings_.begin() && needs_whitespace(iter[-1], *iter))
+            ++size;
+    }
+
     std::string result;
-    for (auto& token : tokens_)
+    result.reserve(size);
+    for (auto iter = spellings_.begin(); iter != spellings_.end(); ++iter)
     {
-        DEBUG_ASSERT(!token.spelling.empty(), detail::assert_handler{});
-        if (!result.empty() && is_identifier(result.back()) && is_identifier(token.spelling[0u]))
+        if (iter != spellings_.begin() && needs_whitespace(iter[-1], *iter))
             result += ' ';
-        result += token.spelling;
+        result += iter->str();
     }
     return result;
 }
 
 bool cppast::operator==(const cpp_token_string& lhs, const cpp_token_string& rhs)
 {
-    if (lhs.tokens_.size() != rhs.tokens_.size())
-        return false;
-    return std::equal(lhs.tokens_.begin(), lhs.tokens_.end(), rhs.tokens_.begin());
+    // spellings are interned, so this just compares pointers
+    return lhs.spellings_ == rhs.spellings_;
 }
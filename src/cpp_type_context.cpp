@@ -0,0 +1,302 @@
+// Copyright (C) 2017-2019 Jonathan Müller <jonathanmueller.dev@gmail.com>
+// This file is subject to the license terms in the LICENSE file
+// found in the top-level directory of this distribution.
+
+#include <cppast/cpp_type_context.hpp>
+
+#include <cppast/cpp_array_type.hpp>
+#include <cppast/cpp_entity_index.hpp>
+#include <cppast/cpp_function_type.hpp>
+#include <cppast/cpp_template_parameter.hpp>
+
+using namespace cppast;
+
+namespace
+{
+std::size_t combine(std::size_t hash, std::size_t value) noexcept
+{
+    return std::size_t((detail::hash_type(hash) ^ detail::hash_type(value)) * detail::fnv_prime);
+}
+
+// names are interned, so the address of the string identifies it
+std::size_t hash_name(const std::string& name) noexcept
+{
+    return std::hash<const std::string*>()(&name);
+}
+
+template <typename T, typename Predicate>
+std::size_t hash_ref(const basic_cpp_entity_ref<T, Predicate>& ref) noexcept
+{
+    auto hash = hash_name(ref.name());
+    for (auto& id : ref.id())
+        hash = combine(hash, std::size_t(static_cast<detail::hash_type>(id)));
+    return hash;
+}
+
+template <typename T, typename Predicate>
+bool equal_ref(const basic_cpp_entity_ref<T, Predicate>& lhs,
+               const basic_cpp_entity_ref<T, Predicate>& rhs) noexcept
+{
+    if (&lhs.name() != &rhs.name() || lhs.no_overloaded() != rhs.no_overloaded())
+        return false;
+
+    auto rhs_iter = rhs.id().begin();
+    for (auto& id : lhs.id())
+        if (id != *rhs_iter++)
+            return false;
+    return true;
+}
+
+bool can_share(const cpp_type& type) noexcept
+{
+    switch (type.kind())
+    {
+    case cpp_type_kind::builtin_t:
+    case cpp_type_kind::user_defined_t:
+    case cpp_type_kind::auto_t:
+    case cpp_type_kind::decltype_auto_t:
+    case cpp_type_kind::template_parameter_t:
+    case cpp_type_kind::unexposed_t:
+        return true;
+
+    case cpp_type_kind::cv_qualified_t:
+        return static_cast<const cpp_cv_qualified_type&>(type).type().is_shared();
+    case cpp_type_kind::pointer_t:
+        return static_cast<const cpp_pointer_type&>(type).pointee().is_shared();
+    case cpp_type_kind::reference_t:
+        return static_cast<const cpp_reference_type&>(type).referee().is_shared();
+    case cpp_type_kind::member_object_t:
+    {
+        auto& member = static_cast<const cpp_member_object_type&>(type);
+        return member.class_type().is_shared() && member.object_type().is_shared();
+    }
+    case cpp_type_kind::dependent_t:
+        return static_cast<const cpp_dependent_type&>(type).dependee().is_shared();
+
+    case cpp_type_kind::decltype_t:
+    case cpp_type_kind::array_t:
+    case cpp_type_kind::function_t:
+    case cpp_type_kind::member_function_t:
+    case cpp_type_kind::template_instantiation_t:
+        break;
+    }
+
+    return false;
+}
+} // namespace
+
+cpp_type_context::~cpp_type_context() noexcept
+{
+    // destroy a type before its subtypes, they are still needed to check whether they're shared
+    while (!storage_.empty())
+        storage_.pop_back();
+}
+
+void cpp_type_context::share_subtypes(cpp_type& type)
+{
+    switch (type.kind())
+    {
+    case cpp_type_kind::cv_qualified_t:
+        share(static_cast<cpp_cv_qualified_type&>(type).type_);
+        break;
+    case cpp_type_kind::pointer_t:
+        share(static_cast<cpp_pointer_type&>(type).pointee_);
+        break;
+    case cpp_type_kind::reference_t:
+        share(static_cast<cpp_reference_type&>(type).referee_);
+        break;
+    case cpp_type_kind::dependent_t:
+        share(static_cast<cpp_dependent_type&>(type).dependee_);
+        break;
+
+    case cpp_type_kind::array_t:
+        share(static_cast<cpp_array_type&>(type).type_);
+        break;
+    case cpp_type_kind::function_t:
+    {
+        auto& func = static_cast<cpp_function_type&>(type);
+        share(func.return_type_);
+        // parameters are owned by the list, so only their subtypes can be shared
+        for (auto& param : func.parameters_)
+            share_subtypes(param);
+        break;
+    }
+    case cpp_type_kind::member_function_t:
+    {
+        auto& func = static_cast<cpp_member_function_type&>(type);
+        share(func.class_type_);
+        share(func.return_type_);
+        for (auto& param : func.parameters_)
+            share_subtypes(param);
+        break;
+    }
+    case cpp_type_kind::member_object_t:
+    {
+        auto& member = static_cast<cpp_member_object_type&>(type);
+        share(member.class_type_);
+        share(member.object_type_);
+        break;
+    }
+
+    case cpp_type_kind::builtin_t:
+    case cpp_type_kind::user_defined_t:
+    case cpp_type_kind::auto_t:
+    case cpp_type_kind::decltype_t:
+    case cpp_type_kind::decltype_auto_t:
+    case cpp_type_kind::template_parameter_t:
+    case cpp_type_kind::template_instantiation_t:
+    case cpp_type_kind::unexposed_t:
+        break;
+    }
+}
+
+void cpp_type_context::share(detail::cpp_type_ptr& type)
+{
+    if (type->is_shared())
+        return;
+
+    share_subtypes(*type);
+    if (!can_share(*type))
+        return;
+
+    auto iter = types_.find(type.get());
+    if (iter != types_.end())
+        // destroys the new type, its subtypes are shared
+        type.reset(*iter);
+    else
+    {
+        storage_.reserve(storage_.size() + 1u);
+        types_.insert(type.get());
+        type->shared_ = true;
+        storage_.emplace_back(type.get());
+    }
+}
+
+std::size_t cpp_type_context::hash::operator()(const cpp_type* type) const noexcept
+{
+    auto result = std::size_t(type->kind());
+    switch (type->kind())
+    {
+    case cpp_type_kind::builtin_t:
+        return combine(result,
+                       std::size_t(
+                           static_cast<const cpp_builtin_type*>(type)->builtin_type_kind()));
+    case cpp_type_kind::user_defined_t:
+        return combine(result, hash_ref(static_cast<const cpp_user_defined_type*>(type)->entity()));
+    case cpp_type_kind::template_parameter_t:
+        return combine(result,
+                       hash_ref(static_cast<const cpp_template_parameter_type*>(type)->entity()));
+    case cpp_type_kind::unexposed_t:
+        return combine(result, hash_name(static_cast<const cpp_unexposed_type*>(type)->name()));
+
+    // subtypes are shared, so they are hashed by their address
+    case cpp_type_kind::cv_qualified_t:
+    {
+        auto cv = static_cast<const cpp_cv_qualified_type*>(type);
+        result  = combine(result, std::hash<const cpp_type*>()(&cv->type()));
+        return combine(result, std::size_t(cv->cv_qualifier()));
+    }
+    case cpp_type_kind::pointer_t:
+        return combine(result,
+                       std::hash<const cpp_type*>()(
+                           &static_cast<const cpp_pointer_type*>(type)->pointee()));
+    case cpp_type_kind::reference_t:
+    {
+        auto ref = static_cast<const cpp_reference_type*>(type);
+        result   = combine(result, std::hash<const cpp_type*>()(&ref->referee()));
+        return combine(result, std::size_t(ref->reference_kind()));
+    }
+    case cpp_type_kind::member_object_t:
+    {
+        auto member = static_cast<const cpp_member_object_type*>(type);
+        result      = combine(result, std::hash<const cpp_type*>()(&member->class_type()));
+        return combine(result, std::hash<const cpp_type*>()(&member->object_type()));
+    }
+    case cpp_type_kind::dependent_t:
+    {
+        auto dependent = static_cast<const cpp_dependent_type*>(type);
+        result         = combine(result, hash_name(dependent->name()));
+        return combine(result, std::hash<const cpp_type*>()(&dependent->dependee()));
+    }
+
+    case cpp_type_kind::auto_t:
+    case cpp_type_kind::decltype_auto_t:
+    case cpp_type_kind::decltype_t:
+    case cpp_type_kind::array_t:
+    case cpp_type_kind::function_t:
+    case cpp_type_kind::member_function_t:
+    case cpp_type_kind::template_instantiation_t:
+        break;
+    }
+
+    return result;
+}
+
+bool cpp_type_context::equal::operator()(const cpp_type* lhs, const cpp_type* rhs) const noexcept
+{
+    if (lhs->kind() != rhs->kind())
+        return false;
+
+    switch (lhs->kind())
+    {
+    case cpp_type_kind::builtin_t:
+        return static_cast<const cpp_builtin_type*>(lhs)->builtin_type_kind()
+               == static_cast<const cpp_builtin_type*>(rhs)->builtin_type_kind();
+    case cpp_type_kind::user_defined_t:
+        return equal_ref(static_cast<const cpp_user_defined_type*>(lhs)->entity(),
+                         static_cast<const cpp_user_defined_type*>(rhs)->entity());
+    case cpp_type_kind::template_parameter_t:
+        return equal_ref(static_cast<const cpp_template_parameter_type*>(lhs)->entity(),
+                         static_cast<const cpp_template_parameter_type*>(rhs)->entity());
+    case cpp_type_kind::unexposed_t:
+        return &static_cast<const cpp_unexposed_type*>(lhs)->name()
+               == &static_cast<const cpp_unexposed_type*>(rhs)->name();
+
+    // subtypes are shared, so they are compared by their address
+    case cpp_type_kind::cv_qualified_t:
+    {
+        auto lhs_cv = static_cast<const cpp_cv_qualified_type*>(lhs);
+        auto rhs_cv = static_cast<const cpp_cv_qualified_type*>(rhs);
+        return &lhs_cv->type() == &rhs_cv->type()
+               && lhs_cv->cv_qualifier() == rhs_cv->cv_qualifier();
+    }
+    case cpp_type_kind::pointer_t:
+        return &static_cast<const cpp_pointer_type*>(lhs)->pointee()
+               == &static_cast<const cpp_pointer_type*>(rhs)->pointee();
+    case cpp_type_kind::reference_t:
+    {
+        auto lhs_ref = static_cast<const cpp_reference_type*>(lhs);
+        auto rhs_ref = static_cast<const cpp_reference_type*>(rhs);
+        return &lhs_ref->referee() == &rhs_ref->referee()
+               && lhs_ref->reference_kind() == rhs_ref->reference_kind();
+    }
+    case cpp_type_kind::member_object_t:
+    {
+        auto lhs_member = static_cast<const cpp_member_object_type*>(lhs);
+        auto rhs_member = static_cast<const cpp_member_object_type*>(rhs);
+        return &lhs_member->class_type() == &rhs_member->class_type()
+               && &lhs_member->object_type() == &rhs_member->object_type();
+    }
+    case cpp_type_kind::dependent_t:
+    {
+        auto lhs_dependent = static_cast<const cpp_dependent_type*>(lhs);
+        auto rhs_dependent = static_cast<const cpp_dependent_type*>(rhs);
+        return &lhs_dependent->name() == &rhs_dependent->name()
+               && &lhs_dependent->dependee() == &rhs_dependent->dependee();
+    }
+
+    case cpp_type_kind::auto_t:
+    case cpp_type_kind::decltype_auto_t:
+        return true;
+
+    case cpp_type_kind::decltype_t:
+    case cpp_type_kind::array_t:
+    case cpp_type_kind::function_t:
+    case cpp_type_kind::member_function_t:
+    case cpp_type_kind::template_instantiation_t:
+        break;
+    }
+
+    // never shared
+    return lhs == rhs;
+}
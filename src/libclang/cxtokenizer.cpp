@@ -4,7 +4,9 @@
 
 #include "cxtokenizer.hpp"
 
+#include <algorithm>
 #include <cctype>
+#include <cstring>
 
 #include "libclang_visitor.hpp"
 #include "parse_error.hpp"
@@ -13,10 +15,6 @@
 
 using namespace cppast;
 
-detail::cxtoken::cxtoken(const CXTranslationUnit& tu_unit, const CXToken& token)
-: value_(clang_getTokenSpelling(tu_unit, token)), kind_(clang_getTokenKind(token))
-{}
-
 namespace
 {
 bool cursor_is_function(CXCursorKind kind)
@@ -85,157 +83,158 @@ public:
         return tokens_[i];
     }
 
-    std::string get_spelling(std::size_t length) noexcept
-    {
-        // might need multiple tokens, because [[, for example, is treated as two separate tokens
-
-        std::string result;
-        for (auto cur = 0u; cur < no_; ++cur)
-        {
-            auto cur_spelling = detail::cxstring(clang_getTokenSpelling(tu_, tokens_[cur]));
-            result += cur_spelling.c_str();
-            if (result.length() >= length)
-                return result;
-        }
-        return result;
-    }
-
 private:
     CXTranslationUnit tu_;
     CXToken*          tokens_;
     unsigned          no_;
 };
 
-CXSourceLocation get_next_location_impl(const CXTranslationUnit& tu, CXFile file,
-                                        const CXSourceLocation& loc, int inc = 1)
+// returns the number of tokens starting at index i that spell str, or zero if they don't
+std::size_t match_tokens(const detail::cxtoken_table& table, std::size_t i, const char* str)
 {
-    DEBUG_ASSERT(clang_Location_isFromMainFile(loc), detail::assert_handler{});
+    // might need multiple tokens, because [[, for example, is treated as two separate tokens
+    auto begin = i;
+    for (; *str; ++i)
+    {
+        if (i == table.size())
+            return 0u;
 
-    unsigned offset;
-    clang_getSpellingLocation(loc, nullptr, nullptr, nullptr, &offset);
-    if (inc >= 0)
-        offset += unsigned(inc);
-    else
-        offset -= unsigned(-inc);
-    return clang_getLocationForOffset(tu, file, offset);
+        auto& spelling = table[i].value();
+        if (std::strncmp(str, spelling.c_str(), spelling.length()) != 0)
+            return 0u;
+        str += spelling.length();
+    }
+    return i - begin;
 }
 
-CXSourceLocation get_next_location(const CXTranslationUnit& tu, const CXFile& file,
-                                   const CXSourceLocation& loc, std::size_t token_length)
+bool token_at_is(const detail::cxtoken_table& table, std::size_t i, const char* token_str)
 {
-    // simple move over by token_length
-    return get_next_location_impl(tu, file, loc, int(token_length));
+    return match_tokens(table, i, token_str) != 0u;
 }
 
-CXSourceLocation get_prev_location(const CXTranslationUnit& tu, const CXFile& file,
-                                   const CXSourceLocation& loc, std::size_t token_length)
+// whether the tokens right before index i spell str
+bool token_before_is(const detail::cxtoken_table& table, std::size_t i, const char* token_str)
 {
-    auto inc = 1;
-    while (true)
-    {
-        auto loc_before = get_next_location_impl(tu, file, loc, -inc);
-        DEBUG_ASSERT(!clang_equalLocations(loc_before, loc), detail::assert_handler{});
-
-        if (!clang_Location_isFromMainFile(loc_before))
-            // out of range
-            return clang_getNullLocation();
-
-        simple_tokenizer tokenizer(tu, clang_getRange(loc_before, loc));
+    for (auto length = std::size_t(1u); length <= i && length <= std::strlen(token_str); ++length)
+        if (match_tokens(table, i - length, token_str) == length)
+            return true;
+    return false;
+}
 
-        auto token_location = clang_getTokenLocation(tu, tokenizer[0]);
-        if (clang_equalLocations(loc_before, token_location))
+bool consume_if_token_before_is(const detail::cxtoken_table& table, std::size_t& i,
+                                const char* token_str)
+{
+    for (auto length = std::size_t(1u); length <= i && length <= std::strlen(token_str); ++length)
+        if (match_tokens(table, i - length, token_str) == length)
         {
-            // actually found a new token and not just whitespace
-            // loc_before is now the last character of the new token
-            // need to move by token_length - 1 to get to the first character
-            return get_next_location_impl(tu, file, loc, -1 * (inc + int(token_length) - 1));
+            i -= length;
+            return true;
         }
-        else
-            ++inc;
-    }
-
-    return clang_getNullLocation();
+    return false;
 }
 
-bool token_at_is(const CXTranslationUnit& tu, const CXFile& file, const CXSourceLocation& loc,
-                 const char* token_str)
+// returns the end offset of the token before the next token that is token_str
+// (this excludes the token itself)
+unsigned extend_until(const detail::cxtoken_table& table, unsigned end, const char* token_str)
 {
-    auto length = std::strlen(token_str);
-
-    auto loc_after = get_next_location(tu, file, loc, length);
-    if (!clang_Location_isFromMainFile(loc_after))
-        return false;
+    auto i = table.find(end);
+    if (i == table.size() || token_at_is(table, i, token_str))
+        return end;
 
-    simple_tokenizer tokenizer(tu, clang_getRange(loc, loc_after));
-    return tokenizer.get_spelling(length) == token_str;
+    while (i != table.size() && !token_at_is(table, i, token_str))
+        ++i;
+    return table.end_offset(i - 1u);
 }
 
-bool consume_if_token_at_is(const CXTranslationUnit& tu, const CXFile& file, CXSourceLocation& loc,
-                            const char* token_str)
-{
-    auto length = std::strlen(token_str);
+// returns the index of the token where the body of a function definition begins,
+// if the tokens end with a body
+// this happens when the body has been skipped by clang and thus has no child cursor
+type_safe::optional<std::size_t> get_skipped_body_begin(const detail::cxtoken_table& table,
+                                                        std::size_t first, std::size_t last)
+{
+    // returns the index of the opening bracket matching the closing one at index i,
+    // or first if there is none
+    auto find_opening_bracket = [&](std::size_t i, const char* open,
+                                    const char* close) -> std::size_t {
+        for (auto bracket_count = 0;; --i)
+        {
+            if (table[i] == close)
+                ++bracket_count;
+            else if (table[i] == open)
+                --bracket_count;
 
-    auto loc_after = get_next_location(tu, file, loc, length);
-    if (!clang_Location_isFromMainFile(loc_after))
-        return false;
+            if (bracket_count == 0 || i == first)
+                return i;
+        }
+    };
 
-    simple_tokenizer tokenizer(tu, clang_getRange(loc, loc_after));
-    if (tokenizer.get_spelling(length) == token_str)
+    auto cur         = last;
+    auto has_handler = false;
+    while (cur != first && table[cur - 1u] == "}")
     {
-        loc = loc_after;
-        return true;
-    }
-    else
-        return false;
-}
-
-bool token_before_is(const CXTranslationUnit& tu, const CXFile& file, const CXSourceLocation& loc,
-                     const char* token_str)
-{
-    auto length = std::strlen(token_str);
+        cur = find_opening_bracket(cur - 1u, "{", "}");
+        if (cur == first)
+            break;
+        else if (table[cur - 1u] == ")")
+        {
+            auto paren = find_opening_bracket(cur - 1u, "(", ")");
+            if (paren != first && table[paren - 1u] == "catch")
+            {
+                // handler of a function try block, continue with the previous block
+                cur         = paren - 1u;
+                has_handler = true;
+                continue;
+            }
+        }
 
-    auto loc_before = get_prev_location(tu, file, loc, length);
-    if (!clang_Location_isFromMainFile(loc_before))
-        return false;
+        if (has_handler)
+        {
+            // the body begins with the try, which might be before a constructor initializer
+            auto bracket_count = 0;
+            for (auto i = cur; i-- != first;)
+            {
+                if (table[i] == ")" || table[i] == "}")
+                    ++bracket_count;
+                else if (table[i] == "(" || table[i] == "{")
+                    --bracket_count;
+                else if (bracket_count == 0 && table[i] == "try")
+                    return i;
+            }
+        }
+        return cur;
+    }
 
-    simple_tokenizer tokenizer(tu, clang_getRange(loc_before, loc));
-    return tokenizer.get_spelling(length) == token_str;
+    return type_safe::nullopt;
 }
 
-bool consume_if_token_before_is(const CXTranslationUnit& tu, const CXFile& file,
-                                CXSourceLocation& loc, const char* token_str)
+// tokens starting at the given index, until the offset where clang_tokenize() would stop
+struct token_range
 {
-    auto length = std::strlen(token_str);
-
-    auto loc_before = get_prev_location(tu, file, loc, length);
-    if (!clang_Location_isFromMainFile(loc_before))
-        return false;
-
-    simple_tokenizer tokenizer(tu, clang_getRange(loc_before, loc));
-    if (tokenizer.get_spelling(length) == token_str)
-    {
-        loc = loc_before;
-        return true;
-    }
-    else
-        return false;
-}
+    std::size_t first;
+    unsigned    end;
+};
 
 struct Extent
 {
-    CXSourceRange first_part;
-    CXSourceRange second_part;
+    token_range                      first_part;
+    type_safe::optional<token_range> second_part;
 };
 
 // clang_getCursorExtent() is somehow broken in various ways
-// this function returns the actual CXSourceRange that covers all parts required for parsing
+// this function returns the actual token range that covers all parts required for parsing
 // might include more tokens
 // this function is the reason you shouldn't use libclang
-Extent get_extent(const CXTranslationUnit& tu, const CXFile& file, const CXCursor& cur)
+// returns an empty optional if the cursor isn't in the main file
+type_safe::optional<Extent> get_extent(const detail::cxtoken_table& table, const CXCursor& cur)
 {
-    auto extent = clang_getCursorExtent(cur);
-    auto begin  = clang_getRangeStart(extent);
-    auto end    = clang_getRangeEnd(extent);
+    auto extent       = clang_getCursorExtent(cur);
+    auto begin_offset = table.get_offset(clang_getRangeStart(extent));
+    auto end_offset   = table.get_offset(clang_getRangeEnd(extent));
+    if (!begin_offset || !end_offset)
+        return type_safe::nullopt;
+
+    auto begin = table.find(begin_offset.value());
+    auto end   = end_offset.value();
 
     auto kind = clang_getCursorKind(cur);
 
@@ -244,33 +243,27 @@ Extent get_extent(const CXTranslationUnit& tu, const CXFile& file, const CXCurso
         || kind == CXCursor_VarDecl || kind == CXCursor_FieldDecl || kind == CXCursor_ParmDecl
         || kind == CXCursor_NonTypeTemplateParameter)
     {
-        while (token_before_is(tu, file, begin, "]]") || token_before_is(tu, file, begin, ")"))
+        while (token_before_is(table, begin, "]]") || token_before_is(table, begin, ")"))
         {
             auto save_begin = begin;
-            if (consume_if_token_before_is(tu, file, begin, "]]"))
+            if (consume_if_token_before_is(table, begin, "]]"))
             {
-                while (!consume_if_token_before_is(tu, file, begin, "[["))
-                    begin = get_prev_location(tu, file, begin, 1);
+                while (begin != 0u && !consume_if_token_before_is(table, begin, "[["))
+                    --begin;
             }
-            else if (consume_if_token_before_is(tu, file, begin, ")"))
+            else if (consume_if_token_before_is(table, begin, ")"))
             {
                 // maybe alignas specifier
 
-                auto paren_count = 1;
-                for (auto last_begin = begin; paren_count != 0; last_begin = begin)
+                for (auto paren_count = 1; paren_count != 0 && begin != 0u; --begin)
                 {
-                    if (token_before_is(tu, file, begin, "("))
+                    if (table[begin - 1u] == "(")
                         --paren_count;
-                    else if (token_before_is(tu, file, begin, ")"))
+                    else if (table[begin - 1u] == ")")
                         ++paren_count;
-
-                    begin = get_prev_location(tu, file, begin, 1);
-                    DEBUG_ASSERT(!clang_equalLocations(last_begin, begin),
-                                 detail::parse_error_handler{}, cur,
-                                 "infinite loop in alignas parsing");
                 }
 
-                if (!consume_if_token_before_is(tu, file, begin, "alignas"))
+                if (!consume_if_token_before_is(table, begin, "alignas"))
                 {
                     // not alignas
                     begin = save_begin;
@@ -283,11 +276,8 @@ Extent get_extent(const CXTranslationUnit& tu, const CXFile& file, const CXCurso
     if (cursor_is_function(kind) || cursor_is_function(clang_getTemplateCursorKind(cur)))
     {
         if (clang_CXXMethod_isDefaulted(cur) || !clang_isCursorDefinition(cur))
-        {
             // defaulted or declaration: extend until semicolon
-            while (!token_at_is(tu, file, end, ";"))
-                end = get_next_location(tu, file, end, 1);
-        }
+            end = extend_until(table, end, ";");
         else
         {
             // declaration: remove body, we don't care about that
@@ -300,17 +290,25 @@ Extent get_extent(const CXTranslationUnit& tu, const CXFile& file, const CXCurso
                          || clang_getCursorKind(child) == CXCursor_InitListExpr)
                 {
                     auto child_extent = clang_getCursorExtent(child);
-                    end               = clang_getRangeStart(child_extent);
-                    has_children      = true;
+                    end = table.get_offset(clang_getRangeStart(child_extent)).value_or(end);
+                    has_children = true;
                 }
             });
+
+            if (!has_children)
+            {
+                // body might have been skipped (CXTranslationUnit_SkipFunctionBodies),
+                // so there is no child, but the extent can still cover it
+                auto body_begin = get_skipped_body_begin(table, begin, table.find_end(begin, end));
+                if (body_begin)
+                    end = table.begin_offset(body_begin.value());
+            }
         }
     }
     else if (cursor_is_var(kind) || cursor_is_var(clang_getTemplateCursorKind(cur)))
     {
         // need to extend until the semicolon
-        while (!token_at_is(tu, file, end, ";"))
-            end = get_next_location(tu, file, end, 1);
+        end = extend_until(table, end, ";");
 
         if (has_inline_type_definition(cur))
         {
@@ -319,100 +317,166 @@ Extent get_extent(const CXTranslationUnit& tu, const CXFile& file, const CXCurso
             auto type_cursor = clang_getTypeDeclaration(clang_getCursorType(cur));
             auto type_extent = clang_getCursorExtent(type_cursor);
 
-            auto type_begin = clang_getRangeStart(type_extent);
-            auto type_end   = clang_getRangeEnd(type_extent);
-
-            return {clang_getRange(begin, type_begin), clang_getRange(type_end, end)};
+            auto type_begin = table.get_offset(clang_getRangeStart(type_extent));
+            auto type_end   = table.get_offset(clang_getRangeEnd(type_extent));
+            if (type_begin && type_end)
+                return Extent{token_range{begin, type_begin.value()},
+                              token_range{table.find(type_end.value()), end}};
         }
     }
-    else if (kind == CXCursor_TemplateTypeParameter && token_at_is(tu, file, end, "("))
+    else if (kind == CXCursor_TemplateTypeParameter && token_at_is(table, table.find(end), "("))
     {
         // if you have decltype as default argument for a type template parameter
         // libclang doesn't include the parameters
-        auto next = get_next_location(tu, file, end, 1);
-        auto prev = end;
-        for (auto paren_count = 1; paren_count != 0; next = get_next_location(tu, file, next, 1))
+        auto next = table.find(end) + 1u;
+        for (auto paren_count = 1; paren_count != 0 && next != table.size(); ++next)
         {
-            if (token_at_is(tu, file, next, "("))
+            if (table[next] == "(")
                 ++paren_count;
-            else if (token_at_is(tu, file, next, ")"))
+            else if (table[next] == ")")
                 --paren_count;
-            prev = next;
         }
-        end = next;
+        end = table.end_offset(next - 1u);
     }
-    else if (kind == CXCursor_TemplateTemplateParameter && token_at_is(tu, file, end, "<"))
+    else if (kind == CXCursor_TemplateTemplateParameter && token_at_is(table, table.find(end), "<"))
     {
         // if you have a template template parameter in a template template parameter,
         // the tokens are all messed up, only contain the `template`
 
         // first: skip to closing angle bracket
         // luckily no need to handle expressions here
-        auto next = get_next_location(tu, file, end, 1);
-        for (auto angle_count = 1; angle_count != 0; next = get_next_location(tu, file, next, 1))
+        auto next = table.find(end) + 1u;
+        for (auto angle_count = 1; angle_count > 0 && next != table.size(); ++next)
         {
-            if (token_at_is(tu, file, next, ">"))
+            if (table[next] == ">")
                 --angle_count;
-            else if (token_at_is(tu, file, next, ">>"))
+            else if (table[next] == ">>")
                 angle_count -= 2;
-            else if (token_at_is(tu, file, next, "<"))
+            else if (table[next] == "<")
                 ++angle_count;
         }
 
         // second: skip until end of parameter
         // no need to handle default, so look for '>' or ','
-        while (!token_at_is(tu, file, next, ">") && !token_at_is(tu, file, next, ","))
-            next = get_next_location(tu, file, next, 1);
+        while (next != table.size() && table[next] != ">" && table[next] != ",")
+            ++next;
         // now we found the proper end of the token
-        end = get_prev_location(tu, file, next, 1);
+        end = table.end_offset(next - 1u);
     }
     else if ((kind == CXCursor_TemplateTypeParameter || kind == CXCursor_NonTypeTemplateParameter
               || kind == CXCursor_TemplateTemplateParameter))
     {
         // variadic tokens in unnamed parameter not included
-        consume_if_token_at_is(tu, file, end, "...");
+        auto next = table.find(end);
+        if (token_at_is(table, next, "..."))
+            end = table.end_offset(next);
     }
-    else if (kind == CXCursor_EnumDecl && !token_at_is(tu, file, end, ";"))
-    {
-        while (!token_at_is(tu, file, end, ";"))
-            end = get_next_location(tu, file, end, 1);
-    }
-    else if (kind == CXCursor_EnumConstantDecl && !token_at_is(tu, file, end, ","))
+    else if (kind == CXCursor_EnumDecl)
+        end = extend_until(table, end, ";");
+    else if (kind == CXCursor_EnumConstantDecl && !token_at_is(table, table.find(end), ","))
     {
         // need to support attributes
         // just give up and extend the range to the range of the entire enum...
         auto parent = clang_getCursorLexicalParent(cur);
-        end         = clang_getRangeEnd(clang_getCursorExtent(parent));
+        end = table.get_offset(clang_getRangeEnd(clang_getCursorExtent(parent))).value_or(end);
     }
     else if (kind == CXCursor_UnexposedDecl)
     {
         // include semicolon, if necessary
-        if (token_at_is(tu, file, end, ";"))
-            end = get_next_location(tu, file, end, 1);
+        auto next = table.find(end);
+        if (token_at_is(table, next, ";"))
+            end = table.end_offset(next);
     }
 
-    return Extent{clang_getRange(begin, end), clang_getNullRange()};
+    return Extent{token_range{begin, end}, type_safe::nullopt};
 }
 } // namespace
 
-detail::cxtokenizer::cxtokenizer(const CXTranslationUnit& tu, const CXFile& file,
-                                 const CXCursor& cur)
-: unmunch_(false)
+detail::cxtoken_table::cxtoken_table(const CXTranslationUnit& tu, const CXFile& file)
+: tu_(tu), file_(file)
 {
-    auto extent = get_extent(tu, file, cur);
+    // the extent of the translation unit is the entire main file
+    simple_tokenizer tokenizer(tu, clang_getCursorExtent(clang_getTranslationUnitCursor(tu)));
 
-    simple_tokenizer tokenizer(tu, extent.first_part);
+    // no reallocation, tokens refer to the spellings
+    spellings_.reserve(tokenizer.size());
     tokens_.reserve(tokenizer.size());
+    begins_.reserve(tokenizer.size());
+    ends_.reserve(tokenizer.size());
     for (auto i = 0u; i != tokenizer.size(); ++i)
-        tokens_.emplace_back(tu, tokenizer[i]);
+    {
+        spellings_.emplace_back(clang_getTokenSpelling(tu, tokenizer[i]));
+        tokens_.emplace_back(spellings_.back(), clang_getTokenKind(tokenizer[i]));
+
+        auto extent = clang_getTokenExtent(tu, tokenizer[i]);
+        begins_.push_back(get_offset(clang_getRangeStart(extent)).value());
+        ends_.push_back(get_offset(clang_getRangeEnd(extent)).value());
+    }
+}
+
+type_safe::optional<unsigned> detail::cxtoken_table::get_offset(const CXSourceLocation& loc) const
+    noexcept
+{
+    CXFile   file;
+    unsigned offset;
+    clang_getSpellingLocation(loc, &file, nullptr, nullptr, &offset);
+    if (!clang_File_isEqual(file, file_))
+        return type_safe::nullopt;
+    return offset;
+}
 
-    if (!clang_Range_isNull(extent.second_part))
+std::size_t detail::cxtoken_table::find(unsigned offset) const noexcept
+{
+    return std::size_t(std::lower_bound(begins_.begin(), begins_.end(), offset) - begins_.begin());
+}
+
+std::size_t detail::cxtoken_table::find_end(std::size_t first, unsigned end) const noexcept
+{
+    if (first >= ends_.size())
+        return ends_.size();
+
+    // the lexer stops after the first token that reaches the end offset,
+    // but it always returns at least one token
+    auto last = std::lower_bound(ends_.begin() + std::ptrdiff_t(first), ends_.end(), end);
+    return last == ends_.end() ? ends_.size() : std::size_t(last - ends_.begin()) + 1u;
+}
+
+detail::cxtokenizer::cxtokenizer(const cxtoken_table& table, const CXCursor& cur)
+: unmunch_(false)
+{
+    auto extent = get_extent(table, cur);
+    if (!extent)
     {
-        simple_tokenizer second_tokenizer(tu, extent.second_part);
-        tokens_.reserve(tokens_.size() + second_tokenizer.size());
-        for (auto i = 0u; i != second_tokenizer.size(); ++i)
-            tokens_.emplace_back(tu, second_tokenizer[i]);
+        // not in the main file, need to tokenize it on our own
+        simple_tokenizer tokenizer(table.tu(), clang_getCursorExtent(cur));
+        spellings_.reserve(tokenizer.size());
+        tokens_.reserve(tokenizer.size());
+        for (auto i = 0u; i != tokenizer.size(); ++i)
+        {
+            spellings_.emplace_back(clang_getTokenSpelling(table.tu(), tokenizer[i]));
+            tokens_.emplace_back(spellings_.back(), clang_getTokenKind(tokenizer[i]));
+        }
     }
+    else if (!extent.value().second_part)
+    {
+        auto& part = extent.value().first_part;
+        begin_     = table.begin() + part.first;
+        end_       = table.begin() + table.find_end(part.first, part.end);
+        return;
+    }
+    else
+    {
+        // tokens aren't contiguous, need to copy them
+        auto& first  = extent.value().first_part;
+        auto& second = extent.value().second_part.value();
+        tokens_.assign(table.begin() + first.first,
+                       table.begin() + table.find_end(first.first, first.end));
+        tokens_.insert(tokens_.end(), table.begin() + second.first,
+                       table.begin() + table.find_end(second.first, second.end));
+    }
+
+    begin_ = tokens_.data();
+    end_   = tokens_.data() + tokens_.size();
 }
 
 void detail::skip(detail::cxtoken_stream& stream, const char* str)
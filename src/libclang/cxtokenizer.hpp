@@ -10,6 +10,7 @@
 
 #include <cppast/cpp_attribute.hpp>
 #include <cppast/cpp_token.hpp>
+#include <type_safe/optional.hpp>
 
 #include "raii_wrapper.hpp"
 
@@ -20,16 +21,18 @@ namespace detail
     class cxtoken
     {
     public:
-        explicit cxtoken(const CXTranslationUnit& tu_unit, const CXToken& token);
+        explicit cxtoken(const cxstring& value, CXTokenKind kind) noexcept
+        : value_(&value), kind_(kind)
+        {}
 
         const cxstring& value() const noexcept
         {
-            return value_;
+            return *value_;
         }
 
         const char* c_str() const noexcept
         {
-            return value_.c_str();
+            return value_->c_str();
         }
 
         CXTokenKind kind() const noexcept
@@ -38,8 +41,8 @@ namespace detail
         }
 
     private:
-        cxstring    value_;
-        CXTokenKind kind_;
+        const cxstring* value_;
+        CXTokenKind     kind_;
     };
 
     inline bool operator==(const cxtoken& tok, const char* str) noexcept
@@ -62,21 +65,96 @@ namespace detail
         return !(str == tok);
     }
 
-    using cxtoken_iterator = std::vector<cxtoken>::const_iterator;
+    using cxtoken_iterator = const cxtoken*;
+
+    // all tokens of the main file of a translation unit
+    // the file is tokenized once, a cxtokenizer is just a view into the table
+    class cxtoken_table
+    {
+    public:
+        explicit cxtoken_table(const CXTranslationUnit& tu, const CXFile& file);
+
+        cxtoken_table(const cxtoken_table&) = delete;
+        cxtoken_table& operator=(const cxtoken_table&) = delete;
+
+        const CXTranslationUnit& tu() const noexcept
+        {
+            return tu_;
+        }
+
+        const CXFile& file() const noexcept
+        {
+            return file_;
+        }
+
+        cxtoken_iterator begin() const noexcept
+        {
+            return tokens_.data();
+        }
+
+        cxtoken_iterator end() const noexcept
+        {
+            return tokens_.data() + tokens_.size();
+        }
+
+        std::size_t size() const noexcept
+        {
+            return tokens_.size();
+        }
+
+        const cxtoken& operator[](std::size_t i) const noexcept
+        {
+            return tokens_[i];
+        }
+
+        // offset of the first character of the token
+        unsigned begin_offset(std::size_t i) const noexcept
+        {
+            return begins_[i];
+        }
+
+        // offset one past the last character of the token
+        unsigned end_offset(std::size_t i) const noexcept
+        {
+            return ends_[i];
+        }
+
+        // returns the offset of the location,
+        // or an empty optional if it isn't in the main file
+        type_safe::optional<unsigned> get_offset(const CXSourceLocation& loc) const noexcept;
+
+        // returns the index of the first token starting at or after the offset
+        std::size_t find(unsigned offset) const noexcept;
+
+        // returns one past the index of the last token clang_tokenize() returns
+        // for a range starting at the token with the given index and ending at the offset
+        std::size_t find_end(std::size_t first, unsigned end) const noexcept;
+
+    private:
+        CXTranslationUnit     tu_;
+        CXFile                file_;
+        std::vector<cxstring> spellings_;
+        std::vector<cxtoken>  tokens_;
+        // begin and end offset of each token, both sorted
+        std::vector<unsigned> begins_, ends_;
+    };
 
     class cxtokenizer
     {
     public:
-        explicit cxtokenizer(const CXTranslationUnit& tu, const CXFile& file, const CXCursor& cur);
+        explicit cxtokenizer(const cxtoken_table& table, const CXCursor& cur);
+
+        cxtokenizer(const cxtokenizer&) = delete;
+        cxtokenizer& operator=(const cxtokenizer&) = delete;
 
         cxtoken_iterator begin() const noexcept
         {
-            return tokens_.begin();
+            return begin_;
         }
 
         cxtoken_iterator end() const noexcept
         {
-            return tokens_.end();
+            return end_;
         }
 
         // if it returns true, the last token is ">>",
@@ -88,8 +166,11 @@ namespace detail
         }
 
     private:
-        std::vector<cxtoken> tokens_;
-        bool                 unmunch_;
+        // only used if the tokens aren't contiguous in the table
+        std::vector<cxstring> spellings_;
+        std::vector<cxtoken>  tokens_;
+        cxtoken_iterator      begin_, end_;
+        bool                  unmunch_;
     };
 
     class cxtoken_stream
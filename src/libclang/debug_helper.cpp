@@ -50,7 +50,8 @@ void detail::print_tokens(const CXTranslationUnit& tu, const CXFile& file,
                           const CXCursor& cur) noexcept
 {
     std::lock_guard<std::mutex> lock(mtx);
-    detail::cxtokenizer         tokenizer(tu, file, cur);
+    detail::cxtoken_table       table(tu, file);
+    detail::cxtokenizer         tokenizer(table, cur);
     for (auto& token : tokenizer)
         std::fprintf(stderr, "%s ", token.c_str());
     std::fputs("\n", stderr);
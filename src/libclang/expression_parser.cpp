@@ -14,7 +14,7 @@ std::unique_ptr<cpp_expression> detail::parse_expression(const detail::parse_con
     auto kind = clang_getCursorKind(cur);
     DEBUG_ASSERT(clang_isExpression(kind), detail::assert_handler{});
 
-    detail::cxtokenizer    tokenizer(context.tu, context.file, cur);
+    detail::cxtokenizer    tokenizer(*context.tokens, cur);
     detail::cxtoken_stream stream(tokenizer, cur);
 
     auto type = parse_type(context, cur, clang_getCursorType(cur));
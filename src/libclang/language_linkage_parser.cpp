@@ -17,7 +17,7 @@ std::unique_ptr<cpp_entity> detail::try_parse_cpp_language_linkage(const parse_c
     DEBUG_ASSERT(cur.kind == CXCursor_UnexposedDecl,
                  detail::assert_handler{}); // not exposed currently
 
-    detail::cxtokenizer    tokenizer(context.tu, context.file, cur);
+    detail::cxtokenizer    tokenizer(*context.tokens, cur);
     detail::cxtoken_stream stream(tokenizer, cur);
 
     // extern <name> ...
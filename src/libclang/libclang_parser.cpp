@@ -4,10 +4,22 @@
 
 #include <cppast/libclang_parser.hpp>
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
 #include <cstring>
 #include <fstream>
+#include <future>
+#include <list>
+#include <map>
+#include <mutex>
+#include <unordered_map>
 #include <vector>
 
+#include <sys/stat.h>
+
 #include <clang-c/CXCompilationDatabase.h>
 #include <process.hpp>
 
@@ -17,6 +29,7 @@
 #include "parse_functions.hpp"
 #include "preprocessor.hpp"
 #include "raii_wrapper.hpp"
+#include "toolchain_cache.hpp"
 
 using namespace cppast;
 namespace tpl = TinyProcessLib;
@@ -51,37 +64,21 @@ bool detail::libclang_compile_config_access::remove_comments_in_macro(
     return config.remove_comments_in_macro_;
 }
 
-libclang_compilation_database::libclang_compilation_database(const std::string& build_directory)
+bool detail::libclang_compile_config_access::in_process_preprocessing(
+    const libclang_compile_config& config)
 {
-    static_assert(std::is_same<database, CXCompilationDatabase>::value, "forgot to update type");
-
-    auto error = CXCompilationDatabase_NoError;
-    database_  = clang_CompilationDatabase_fromDirectory(build_directory.c_str(), &error);
-    if (error != CXCompilationDatabase_NoError)
-        throw libclang_error("unable to load compilation database");
+    return config.in_process_preprocessing_;
 }
 
-libclang_compilation_database::~libclang_compilation_database()
-{
-    if (database_)
-        clang_CompilationDatabase_dispose(database_);
-}
-
-bool libclang_compilation_database::has_config(const char* file_name) const
+bool detail::libclang_compile_config_access::skip_function_bodies(
+    const libclang_compile_config& config)
 {
-    auto cxcommands = clang_CompilationDatabase_getCompileCommands(database_, file_name);
-    if (!cxcommands)
-        return false;
-    clang_CompileCommands_dispose(cxcommands);
-    return true;
+    return config.skip_function_bodies_;
 }
 
-namespace
-{} // namespace
-
 libclang_compile_config::libclang_compile_config()
 : compile_config({}), write_preprocessed_(false), fast_preprocessing_(false),
-  remove_comments_in_macro_(false)
+  remove_comments_in_macro_(false), in_process_preprocessing_(false), skip_function_bodies_(false)
 {
     // set given clang binary
     set_clang_binary(CPPAST_CLANG_BINARY);
@@ -126,24 +123,75 @@ std::string get_full_path(const detail::cxstring& dir, const std::string& file)
         // relative w/o separator
         return dir.std_str() + file;
 }
-} // namespace
 
-void detail::for_each_file(const libclang_compilation_database& database, void* user_data,
-                           void (*callback)(void*, std::string))
+bool is_separator(char c)
 {
-    cxcompile_commands commands(
-        clang_CompilationDatabase_getAllCompileCommands(database.database_));
-    auto no = clang_CompileCommands_getSize(commands.get());
-    for (auto i = 0u; i != no; ++i)
+    return c == '/' || c == '\\';
+}
+
+// uses forward slashes only and removes "." and "dir/.." components
+std::string normalize_path(const std::string& path)
+{
+    std::string result;
+    auto        ptr = path.c_str();
+    if (has_drive_prefix(path))
     {
-        auto cmd = clang_CompileCommands_getCommand(commands.get(), i);
+        result.assign(ptr, 2u);
+        ptr += 2;
+    }
+    auto absolute = is_separator(*ptr);
+    if (absolute)
+        result += '/';
+    auto root = result.size();
 
-        auto dir = cxstring(clang_CompileCommand_getDirectory(cmd));
-        callback(user_data,
-                 get_full_path(dir, cxstring(clang_CompileCommand_getFilename(cmd)).std_str()));
+    while (*ptr)
+    {
+        while (is_separator(*ptr))
+            ++ptr;
+        auto begin = ptr;
+        while (*ptr && !is_separator(*ptr))
+            ++ptr;
+        auto component = std::string(begin, ptr);
+
+        if (component.empty() || component == ".")
+            continue;
+        else if (component == "..")
+        {
+            auto last       = result.find_last_of('/');
+            auto last_begin = last == std::string::npos || last < root ? root : last + 1u;
+            if (last_begin < result.size()
+                && result.compare(last_begin, std::string::npos, "..") != 0)
+                // remove previous component and its separator
+                result.erase(last_begin == root ? root : last_begin - 1u);
+            else if (!absolute)
+            {
+                if (result.size() > root)
+                    result += '/';
+                result += component;
+            }
+            // else: parent of root is the root
+        }
+        else
+        {
+            if (result.size() > root)
+                result += '/';
+            result += component;
+        }
     }
+
+    return result;
 }
 
+// the full path without the extension
+std::string get_stem(const std::string& path)
+{
+    auto dot = path.rfind('.');
+    if (dot == std::string::npos || path.find('/', dot) != std::string::npos)
+        return path;
+    return path.substr(0, dot);
+}
+} // namespace
+
 namespace
 {
 bool is_flag(const detail::cxstring& str)
@@ -202,75 +250,244 @@ void parse_flags(CXCompileCommand cmd, Func callback)
         // else skip argument
     }
 }
+
+// appends the flags of the command cppast cares about
+void get_config_flags(CXCompileCommand cmd, std::vector<std::string>& result)
+{
+    auto dir = detail::cxstring(clang_CompileCommand_getDirectory(cmd));
+    parse_flags(cmd, [&](std::string flag, std::string args) {
+        if (flag == "-I")
+            result.push_back(std::move(flag) + get_full_path(dir, args));
+        else if (flag == "-isystem")
+            result.push_back(std::move(flag) + get_full_path(dir, args));
+        else if (flag == "-D" || flag == "-U")
+        {
+            // preprocessor options
+            for (auto c : args)
+                if (c == '"')
+                    flag += "\\\"";
+                else
+                    flag += c;
+            result.push_back(std::move(flag));
+        }
+        else if (flag == "-std")
+            // standard
+            result.push_back(std::move(flag) + "=" + std::move(args));
+        else if (flag == "-f")
+            // other options
+            result.push_back(std::move(flag) + std::move(args));
+    });
+}
 } // namespace
 
+// all commands of the database, read once
+struct libclang_compilation_database::index
+{
+    // the distinct flags, most files share them
+    std::vector<std::vector<std::string>> configs;
+    // normalized full path -> index of its flags in configs
+    std::unordered_map<std::string, std::size_t> files;
+    // normalized full path without extension -> normalized full paths
+    std::unordered_map<std::string, std::vector<std::string>> stems;
+    // full path as specified in the database and index of its flags, in the database order
+    std::vector<std::pair<std::string, std::size_t>> order;
+    // whether the database lists all files it has commands for,
+    // false for databases like compile_flags.txt which apply to every file
+    bool complete;
+
+    index() : complete(false) {}
+};
+
+libclang_compilation_database::libclang_compilation_database(const std::string& build_directory)
+: index_(new index)
+{
+    static_assert(std::is_same<database, CXCompilationDatabase>::value, "forgot to update type");
+
+    auto error = CXCompilationDatabase_NoError;
+    database_  = clang_CompilationDatabase_fromDirectory(build_directory.c_str(), &error);
+    if (error != CXCompilationDatabase_NoError)
+        throw libclang_error("unable to load compilation database");
+
+    auto cxcommands = clang_CompilationDatabase_getAllCompileCommands(database_);
+    if (cxcommands == nullptr)
+        return;
+    cxcompile_commands commands(cxcommands);
+
+    // full path as specified and normalized path of each file
+    std::vector<std::pair<std::string, std::string>>          paths;
+    std::unordered_map<std::string, std::vector<std::string>> flags;
+
+    auto no = clang_CompileCommands_getSize(commands.get());
+    for (auto i = 0u; i != no; ++i)
+    {
+        auto cmd  = clang_CompileCommands_getCommand(commands.get(), i);
+        auto dir  = detail::cxstring(clang_CompileCommand_getDirectory(cmd));
+        auto file = detail::cxstring(clang_CompileCommand_getFilename(cmd));
+        auto full = get_full_path(dir, file.std_str());
+        auto path = normalize_path(full);
+
+        auto result = flags.emplace(path, std::vector<std::string>{});
+        if (result.second)
+        {
+            index_->stems[get_stem(path)].push_back(path);
+            paths.emplace_back(std::move(full), std::move(path));
+        }
+        // a file can have multiple commands, just like in a query for the file
+        get_config_flags(cmd, result.first->second);
+    }
+
+    // share the flags between files
+    std::map<std::vector<std::string>, std::size_t> ids;
+    for (auto& path : paths)
+    {
+        auto result = ids.emplace(std::move(flags[path.second]), index_->configs.size());
+        if (result.second)
+            index_->configs.push_back(result.first->first);
+
+        auto id = result.first->second;
+        index_->files.emplace(std::move(path.second), id);
+        index_->order.emplace_back(std::move(path.first), id);
+    }
+    index_->complete = no > 0u;
+}
+
+libclang_compilation_database::libclang_compilation_database(
+    libclang_compilation_database&& other) noexcept
+: database_(other.database_), index_(std::move(other.index_))
+{
+    other.database_ = nullptr;
+}
+
+libclang_compilation_database::~libclang_compilation_database()
+{
+    if (database_)
+        clang_CompilationDatabase_dispose(database_);
+}
+
+libclang_compilation_database& libclang_compilation_database::operator=(
+    libclang_compilation_database&& other) noexcept
+{
+    libclang_compilation_database tmp(std::move(other));
+    std::swap(tmp.database_, database_);
+    std::swap(tmp.index_, index_);
+    return *this;
+}
+
+std::size_t libclang_compilation_database::no_files() const noexcept
+{
+    return index_->order.size();
+}
+
+std::size_t libclang_compilation_database::no_configurations() const noexcept
+{
+    return index_->configs.size();
+}
+
+bool libclang_compilation_database::has_config(const char* file_name) const
+{
+    if (lookup_flags(file_name))
+        return true;
+    else if (is_complete(file_name))
+        // not in the index, so there is no config
+        return false;
+
+    auto cxcommands = clang_CompilationDatabase_getCompileCommands(database_, file_name);
+    if (!cxcommands)
+        return false;
+    clang_CompileCommands_dispose(cxcommands);
+    return true;
+}
+
+const std::vector<std::string>* libclang_compilation_database::lookup_flags(
+    const std::string& file_name) const
+{
+    auto iter = index_->files.find(normalize_path(file_name));
+    return iter == index_->files.end() ? nullptr : &index_->configs[iter->second];
+}
+
+std::string libclang_compilation_database::lookup_stem(const std::string& file_name,
+                                                       const char* const* extensions,
+                                                       std::size_t        no_extensions) const
+{
+    auto stem = normalize_path(file_name);
+    auto iter = index_->stems.find(stem);
+    if (iter == index_->stems.end())
+        return "";
+
+    // use the order of the extensions, not of the database
+    for (auto ext = extensions; ext != extensions + no_extensions; ++ext)
+        for (auto& path : iter->second)
+            if (path.compare(stem.size(), std::string::npos, *ext) == 0)
+                return path;
+    return "";
+}
+
+void detail::for_each_file(const libclang_compilation_database& database, void* user_data,
+                           void (*callback)(void*, std::string, std::size_t))
+{
+    for (auto& file : database.index_->order)
+        callback(user_data, file.first, file.second);
+}
+
+bool libclang_compilation_database::is_complete(const std::string& file_name) const
+{
+    return index_->complete && is_absolute(file_name);
+}
+
 libclang_compile_config::libclang_compile_config(const libclang_compilation_database& database,
                                                  const std::string&                   file)
 : libclang_compile_config()
 {
+    if (auto flags = database.lookup_flags(file))
+    {
+        for (auto& flag : *flags)
+            add_flag(flag);
+        return;
+    }
+
     auto cxcommands
         = clang_CompilationDatabase_getCompileCommands(database.database_, file.c_str());
     if (cxcommands == nullptr)
         throw libclang_error(detail::format("no compile commands specified for file '", file, "'"));
     cxcompile_commands commands(cxcommands);
 
-    auto size = clang_CompileCommands_getSize(commands.get());
+    std::vector<std::string> flags;
+    auto                     size = clang_CompileCommands_getSize(commands.get());
     for (auto i = 0u; i != size; ++i)
-    {
-        auto cmd = clang_CompileCommands_getCommand(commands.get(), i);
-        auto dir = detail::cxstring(clang_CompileCommand_getDirectory(cmd));
-        parse_flags(cmd, [&](std::string flag, std::string args) {
-            if (flag == "-I")
-                add_flag(std::move(flag) + get_full_path(dir, args));
-            else if (flag == "-isystem")
-                add_flag(std::move(flag) + get_full_path(dir, args));
-            else if (flag == "-D" || flag == "-U")
-            {
-                // preprocessor options
-                for (auto c : args)
-                    if (c == '"')
-                        flag += "\\\"";
-                    else
-                        flag += c;
-                add_flag(std::move(flag));
-            }
-            else if (flag == "-std")
-                // standard
-                add_flag(std::move(flag) + "=" + std::move(args));
-            else if (flag == "-f")
-                // other options
-                add_flag(std::move(flag) + std::move(args));
-        });
-    }
+        get_config_flags(clang_CompileCommands_getCommand(commands.get(), i), flags);
+    for (auto& flag : flags)
+        add_flag(std::move(flag));
 }
 
 namespace
 {
-bool is_valid_binary(const std::string& binary)
-{
-    tpl::Process process(binary + " -v", "", [](const char*, std::size_t) {},
-                         [](const char*, std::size_t) {});
-    return process.get_exit_status() == 0;
-}
-
 #if (defined(WIN32) || defined(_WIN32) || defined(__WIN32)) && !defined(__CYGWIN__)
 #    define CPPAST_DETAIL_WINDOWS 1
 #else
 #    define CPPAST_DETAIL_WINDOWS 0
 #endif
 
-void add_default_include_dirs(libclang_compile_config& config)
+// information about a clang binary, obtained by invoking it
+struct toolchain_info
+{
+    bool                     valid;
+    std::vector<std::string> include_dirs;
+
+    toolchain_info() : valid(false) {}
+};
+
+std::vector<std::string> get_default_include_dirs(const std::string& binary)
 {
     std::string  verbose_output;
-    tpl::Process process(detail::libclang_compile_config_access::clang_binary(config)
-                             + " -x c++ -v -",
-                         "", [](const char*, std::size_t) {},
+    tpl::Process process(binary + " -x c++ -v -", "", [](const char*, std::size_t) {},
                          [&](const char* str, std::size_t n) { verbose_output.append(str, n); },
                          true);
     process.write("", 1);
     process.close_stdin();
     process.get_exit_status();
 
+    std::vector<std::string> result;
+
     auto pos = verbose_output.find("#include <...>");
     DEBUG_ASSERT(pos != std::string::npos, detail::assert_handler{});
     while (verbose_output[pos] != '\n')
@@ -308,19 +525,310 @@ void add_default_include_dirs(libclang_compile_config& config)
                 path += c;
         }
 
-        config.add_include_dir(std::move(path));
+        result.push_back(std::move(path));
+    }
+
+    return result;
+}
+
+toolchain_info probe_toolchain(const std::string& binary)
+{
+    toolchain_info result;
+
+    tpl::Process process(binary + " -v", "", [](const char*, std::size_t) {},
+                         [](const char*, std::size_t) {});
+    result.valid = process.get_exit_status() == 0;
+    if (result.valid)
+        result.include_dirs = get_default_include_dirs(binary);
+
+    return result;
+}
+
+// modification time and size of a binary,
+// used to detect whether a persisted toolchain_info is still up-to-date
+struct file_stamp
+{
+    long long mtime, size;
+};
+
+bool operator==(const file_stamp& a, const file_stamp& b) noexcept
+{
+    return a.mtime == b.mtime && a.size == b.size;
+}
+
+type_safe::optional<file_stamp> get_file_stamp(const std::string& path)
+{
+    struct stat info;
+    if (::stat(path.c_str(), &info) != 0 || (info.st_mode & S_IFMT) != S_IFREG)
+        return type_safe::nullopt;
+    return file_stamp{static_cast<long long>(info.st_mtime), static_cast<long long>(info.st_size)};
+}
+
+// stamp of the binary, searching the PATH if it doesn't contain a directory
+type_safe::optional<file_stamp> get_binary_stamp(const std::string& binary)
+{
+#if CPPAST_DETAIL_WINDOWS
+    auto separator = ';';
+    auto suffixes  = {"", ".exe"};
+#else
+    auto separator = ':';
+    auto suffixes  = {""};
+#endif
+
+    if (binary.find_first_of("/\\") != std::string::npos)
+    {
+        for (auto suffix : suffixes)
+            if (auto stamp = get_file_stamp(binary + suffix))
+                return stamp;
+        return type_safe::nullopt;
+    }
+
+    auto path = std::getenv("PATH");
+    if (!path)
+        return type_safe::nullopt;
+
+    for (auto begin = path;; ++begin)
+    {
+        auto end = std::strchr(begin, separator);
+        auto dir = end ? std::string(begin, end) : std::string(begin);
+        if (!dir.empty())
+            for (auto suffix : suffixes)
+                if (auto stamp = get_file_stamp(dir + "/" + binary + suffix))
+                    return stamp;
+
+        if (!end)
+            break;
+        begin = end;
+    }
+    return type_safe::nullopt;
+}
+
+// process-wide cache of toolchain_info, optionally persisted in a file
+class toolchain_cache
+{
+public:
+    static toolchain_cache& get() noexcept
+    {
+        static toolchain_cache cache;
+        return cache;
+    }
+
+    void set_file(std::string path)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        file_ = std::move(path);
+        if (!file_.empty())
+        {
+            load();
+            save(); // persist the binaries already probed
+        }
+    }
+
+    // the binary is probed without holding the lock,
+    // concurrent lookups of the same binary wait for the first one
+    toolchain_info lookup(const std::string& binary)
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+
+        auto iter = entries_.find(binary);
+        if (iter == entries_.end())
+        {
+            lock.unlock();
+            auto stamp = get_binary_stamp(binary);
+            lock.lock();
+
+            iter = entries_.find(binary);
+            if (iter == entries_.end())
+            {
+                std::promise<toolchain_info> promise;
+                auto                         info = promise.get_future().share();
+                entries_.emplace(binary, entry{info, stamp});
+                lock.unlock();
+
+                probe(binary, promise, stamp.has_value());
+                return info.get();
+            }
+        }
+
+        auto info = iter->second.info;
+        lock.unlock();
+        return info.get();
+    }
+
+    std::size_t probe_count()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return no_probes_;
+    }
+
+    void clear()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        entries_.clear();
+        if (!file_.empty())
+            load();
+    }
+
+private:
+    struct entry
+    {
+        std::shared_future<toolchain_info> info;
+        type_safe::optional<file_stamp>    stamp;
+    };
+
+    toolchain_cache() = default;
+
+    void probe(const std::string& binary, std::promise<toolchain_info>& promise, bool persist)
+    {
+        try
+        {
+            promise.set_value(probe_toolchain(binary));
+        }
+        catch (...)
+        {
+            promise.set_exception(std::current_exception());
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        ++no_probes_;
+        if (!file_.empty() && persist)
+            save();
+    }
+
+    static bool is_ready(const std::shared_future<toolchain_info>& info)
+    {
+        return info.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+    }
+
+    // format: one line per binary: <binary>\t<mtime>\t<size>\t<valid>\t<no dirs>
+    // followed by one line per include directory
+    void load()
+    {
+        std::ifstream file(file_);
+        try
+        {
+            load(file);
+        }
+        catch (std::exception&)
+        {
+            // ignore malformed files, they will be overwritten
+        }
+    }
+
+    void load(std::istream& file)
+    {
+        std::string line;
+        if (!std::getline(file, line) || line != "cppast toolchain cache 2")
+            return;
+
+        while (std::getline(file, line))
+        {
+            std::vector<std::string> fields;
+            for (std::size_t begin = 0u, end = 0u; end != std::string::npos; begin = end + 1u)
+            {
+                end = line.find('\t', begin);
+                fields.push_back(line.substr(begin, end == std::string::npos ? end : end - begin));
+            }
+            if (fields.size() != 5u)
+                return;
+
+            file_stamp     stamp{std::stoll(fields[1]), std::stoll(fields[2])};
+            toolchain_info info;
+            info.valid = fields[3] == "1";
+            for (auto n = std::stoul(fields[4]); n != 0u && std::getline(file, line); --n)
+                info.include_dirs.push_back(line);
+
+            // only use it if the binary hasn't changed since
+            auto cur_stamp = get_binary_stamp(fields[0]);
+            if (cur_stamp && cur_stamp.value() == stamp
+                && entries_.find(fields[0]) == entries_.end())
+            {
+                std::promise<toolchain_info> promise;
+                promise.set_value(std::move(info));
+                entries_.emplace(fields[0], entry{promise.get_future().share(), stamp});
+            }
+        }
+    }
+
+    void save() const
+    {
+        auto tmp_file = file_ + ".tmp";
+        {
+            std::ofstream file(tmp_file);
+            file << "cppast toolchain cache 2\n";
+            for (auto& e : entries_)
+            {
+                // binaries that are still being probed are persisted once they are done
+                if (!e.second.stamp || !is_ready(e.second.info))
+                    continue;
+
+                toolchain_info info;
+                try
+                {
+                    info = e.second.info.get();
+                }
+                catch (...)
+                {
+                    continue;
+                }
+
+                file << e.first << '\t' << e.second.stamp.value().mtime << '\t'
+                     << e.second.stamp.value().size << '\t' << (info.valid ? 1 : 0) << '\t'
+                     << info.include_dirs.size() << '\n';
+                for (auto& dir : info.include_dirs)
+                    file << dir << '\n';
+            }
+            if (!file)
+                return;
+        }
+
+        if (std::rename(tmp_file.c_str(), file_.c_str()) != 0)
+        {
+            // rename doesn't overwrite on Windows
+            std::remove(file_.c_str());
+            std::rename(tmp_file.c_str(), file_.c_str());
+        }
     }
+
+    std::mutex                             mutex_;
+    std::unordered_map<std::string, entry> entries_;
+    std::string                            file_;
+    std::size_t                            no_probes_ = 0u;
+};
+
+bool use_clang_binary(libclang_compile_config& config, const std::string& binary,
+                      std::string& clang_binary)
+{
+    auto info = toolchain_cache::get().lookup(binary);
+    if (!info.valid)
+        return false;
+
+    clang_binary = binary;
+    for (auto& dir : info.include_dirs)
+        config.add_include_dir(dir);
+    return true;
 }
 } // namespace
 
+std::size_t detail::toolchain_probe_count()
+{
+    return toolchain_cache::get().probe_count();
+}
+
+void detail::clear_toolchain_cache()
+{
+    toolchain_cache::get().clear();
+}
+
+void libclang_compile_config::set_toolchain_cache_file(std::string path)
+{
+    toolchain_cache::get().set_file(std::move(path));
+}
+
 bool libclang_compile_config::set_clang_binary(std::string binary)
 {
-    if (is_valid_binary(binary))
-    {
-        clang_binary_ = binary;
-        add_default_include_dirs(*this);
+    if (use_clang_binary(*this, binary, clang_binary_))
         return true;
-    }
     else
     {
         // first search in current directory, then in PATH
@@ -328,12 +836,8 @@ bool libclang_compile_config::set_clang_binary(std::string binary)
             = {"./clang++",   "clang++",       "./clang++-4.0", "clang++-4.0", "./clang++-5.0",
                "clang++-5.0", "./clang++-6.0", "clang++-6.0",   "./clang-7",   "clang-7"};
         for (auto& p : paths)
-            if (is_valid_binary(p))
-            {
-                clang_binary_ = p;
-                add_default_include_dirs(*this);
+            if (use_clang_binary(*this, p, clang_binary_))
                 return false;
-            }
 
         throw std::invalid_argument("unable to find clang binary '" + binary + "'");
     }
@@ -420,10 +924,18 @@ type_safe::optional<libclang_compile_config> cppast::find_config_for(
     if (dot != std::string::npos)
         file_name.erase(dot);
 
-    if (database.has_config(file_name))
-        return libclang_compile_config(database, std::move(file_name));
-    static const char* extensions[]
-        = {".h", ".hpp", ".cpp", ".h++", ".c++", ".hxx", ".cxx", ".hh", ".cc", ".H", ".C"};
+    static const char* extensions[] = {"",    ".h",   ".hpp", ".cpp", ".h++", ".c++",
+                                       ".hxx", ".cxx", ".hh",  ".cc",  ".H",   ".C"};
+    if (database.is_complete(file_name))
+    {
+        // the index knows all files with that stem
+        auto name = database.lookup_stem(file_name, extensions,
+                                         sizeof(extensions) / sizeof(extensions[0]));
+        if (name.empty())
+            return type_safe::nullopt;
+        return libclang_compile_config(database, std::move(name));
+    }
+
     for (auto ext : extensions)
     {
         auto name = file_name + ext;
@@ -439,12 +951,241 @@ int cppast::libclang_parser::libclang_minor_version()
     return CINDEX_VERSION_MINOR;
 }
 
+// pool of indices
+// every parse leases its own index, so concurrent parses don't share one
+//
+// also stores the translation units retained for reparsing
 struct libclang_parser::impl
 {
-    detail::cxindex index;
-
-    impl() : index(clang_createIndex(0, 0)) // no diagnostic, other one is irrelevant
+    std::mutex                   mutex;
+    std::vector<detail::cxindex> free_indices;
+    std::atomic<unsigned>        global_options;
+    std::atomic<bool>            use_arena;
+    std::atomic<bool>            share_types;
+
+    impl()
+    : global_options(CXGlobalOpt_None), use_arena(false), share_types(false), retained_memory(0u),
+      max_retained_memory(0u)
     {}
+
+    detail::cxindex acquire()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!free_indices.empty())
+            {
+                auto result = std::move(free_indices.back());
+                free_indices.pop_back();
+                clang_CXIndex_setGlobalOptions(result.get(), global_options);
+                return result;
+            }
+        }
+
+        detail::cxindex result(clang_createIndex(0, 0)); // no diagnostic, other one is irrelevant
+        clang_CXIndex_setGlobalOptions(result.get(), global_options);
+        return result;
+    }
+
+    void release(detail::cxindex index)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        free_indices.push_back(std::move(index));
+    }
+
+    // leases an index for the duration of a parse
+    // must outlive all translation units created with it
+    class index_lease
+    {
+    public:
+        explicit index_lease(impl& pool) : pool_(pool), index_(pool.acquire()), owned_(true) {}
+
+        index_lease(const index_lease&) = delete;
+        index_lease& operator=(const index_lease&) = delete;
+
+        ~index_lease() noexcept
+        {
+            if (owned_)
+                pool_.release(std::move(index_));
+        }
+
+        const detail::cxindex& get() const noexcept
+        {
+            return index_;
+        }
+
+        // takes ownership of the index, it isn't returned to the pool
+        detail::cxindex take() noexcept
+        {
+            owned_ = false;
+            return std::move(index_);
+        }
+
+    private:
+        impl&           pool_;
+        detail::cxindex index_;
+        bool            owned_;
+    };
+
+    struct retained_tu
+    {
+        std::string                path;
+        libclang_compile_config    config;
+        detail::cxindex            index; // must outlive tu
+        detail::cxtranslation_unit tu;
+        std::size_t                memory;
+        bool                       in_use; // by a reparse, it must not be destroyed then
+    };
+
+    std::list<std::unique_ptr<retained_tu>> retained; // most recently used first
+    std::size_t                             retained_memory, max_retained_memory;
+    std::condition_variable                 retained_released;
+
+    bool is_retaining()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return max_retained_memory != 0u;
+    }
+
+    void set_max_retained_memory(std::size_t max)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        max_retained_memory = max;
+        evict();
+    }
+
+    // adds a translation unit, replacing a previous one for the same file
+    void retain(std::unique_ptr<retained_tu> tu)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        remove(lock, tu->path);
+        if (max_retained_memory == 0u)
+            return;
+
+        retained_memory += tu->memory;
+        retained.push_front(std::move(tu));
+        evict();
+    }
+
+    // gives exclusive access to the translation unit of a file
+    // while it is alive, waiting until no other reparse uses it
+    class tu_lease
+    {
+    public:
+        tu_lease(impl& pool, const std::string& path) : pool_(pool), tu_(nullptr), keep_(true)
+        {
+            std::unique_lock<std::mutex> lock(pool_.mutex);
+            while (true)
+            {
+                auto iter = pool_.find(path);
+                if (iter == pool_.retained.end())
+                    break;
+                else if (!(*iter)->in_use)
+                {
+                    // its memory is accounted for again once it is released
+                    tu_         = iter->get();
+                    tu_->in_use = true;
+                    pool_.retained_memory -= tu_->memory;
+                    break;
+                }
+                pool_.retained_released.wait(lock);
+            }
+        }
+
+        tu_lease(const tu_lease&) = delete;
+        tu_lease& operator=(const tu_lease&) = delete;
+
+        // puts the translation unit back, unless it was discarded
+        ~tu_lease() noexcept
+        {
+            if (tu_)
+                pool_.release(*tu_, keep_);
+        }
+
+        explicit operator bool() const noexcept
+        {
+            return tu_ != nullptr;
+        }
+
+        retained_tu& get() const noexcept
+        {
+            return *tu_;
+        }
+
+        // the translation unit is destroyed instead of put back
+        void discard() noexcept
+        {
+            keep_ = false;
+        }
+
+    private:
+        impl&        pool_;
+        retained_tu* tu_;
+        bool         keep_;
+    };
+
+private:
+    using retained_iterator = std::list<std::unique_ptr<retained_tu>>::iterator;
+
+    retained_iterator find(const std::string& path)
+    {
+        for (auto iter = retained.begin(); iter != retained.end(); ++iter)
+            if ((*iter)->path == path)
+                return iter;
+        return retained.end();
+    }
+
+    void release(retained_tu& tu, bool keep) noexcept
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto iter = retained.begin();
+            while (iter->get() != &tu)
+                ++iter;
+
+            tu.in_use = false;
+            if (keep)
+            {
+                retained_memory += tu.memory;
+                retained.splice(retained.begin(), retained, iter);
+            }
+            else
+                retained.erase(iter);
+            evict();
+        }
+        retained_released.notify_all();
+    }
+
+    void remove(std::unique_lock<std::mutex>& lock, const std::string& path)
+    {
+        auto iter = find(path);
+        while (iter != retained.end() && (*iter)->in_use)
+        {
+            retained_released.wait(lock);
+            iter = find(path);
+        }
+
+        if (iter != retained.end())
+        {
+            retained_memory -= (*iter)->memory;
+            retained.erase(iter);
+        }
+    }
+
+    // evicts least recently used translation units until the memory limit is met,
+    // translation units in use are evicted once they are released
+    void evict()
+    {
+        auto iter = retained.end();
+        while (iter != retained.begin() && retained_memory > max_retained_memory)
+        {
+            --iter;
+            if (!(*iter)->in_use)
+            {
+                retained_memory -= (*iter)->memory;
+                iter = retained.erase(iter);
+            }
+        }
+    }
 };
 
 libclang_parser::libclang_parser() : libclang_parser(default_logger()) {}
@@ -455,6 +1196,27 @@ libclang_parser::libclang_parser(type_safe::object_ref<const diagnostic_logger>
 
 libclang_parser::~libclang_parser() noexcept {}
 
+void libclang_parser::set_background_priority(bool value) noexcept
+{
+    pimpl_->global_options = value ? unsigned(CXGlobalOpt_ThreadBackgroundPriorityForAll)
+                                   : unsigned(CXGlobalOpt_None);
+}
+
+void libclang_parser::set_arena_allocation(bool value) noexcept
+{
+    pimpl_->use_arena = value;
+}
+
+void libclang_parser::set_type_sharing(bool value) noexcept
+{
+    pimpl_->share_types = value;
+}
+
+void libclang_parser::retain_translation_units(std::size_t max_memory)
+{
+    pimpl_->set_max_retained_memory(max_memory);
+}
+
 namespace
 {
 std::vector<const char*> get_arguments(const libclang_compile_config& config)
@@ -510,7 +1272,7 @@ void print_diagnostics(const diagnostic_logger& logger, const CXTranslationUnit&
 
 detail::cxtranslation_unit get_cxunit(const diagnostic_logger& logger, const detail::cxindex& idx,
                                       const libclang_compile_config& config, const char* path,
-                                      const std::string& source)
+                                      const std::string& source, bool retain)
 {
     CXUnsavedFile file{path, source.c_str(), static_cast<unsigned long>(source.length())};
 
@@ -519,6 +1281,13 @@ detail::cxtranslation_unit get_cxunit(const diagnostic_logger& logger, const det
     CXTranslationUnit tu;
     auto              flags = CXTranslationUnit_Incomplete | CXTranslationUnit_KeepGoing
                  | CXTranslationUnit_DetailedPreprocessingRecord;
+    if (retain)
+        // precompile the includes, so reparsing only needs to parse the file itself
+        flags |= CXTranslationUnit_PrecompiledPreamble
+                 | CXTranslationUnit_CreatePreambleOnFirstParse;
+    if (detail::libclang_compile_config_access::skip_function_bodies(config))
+        // bodies aren't needed, get_extent() handles definitions without body
+        flags |= CXTranslationUnit_SkipFunctionBodies;
 
     auto error
         = clang_parseTranslationUnit2(idx.get(), path, // index and path
@@ -558,35 +1327,43 @@ unsigned get_line_no(const CXCursor& cursor)
     return line;
 }
 } // namespace
-std::unique_ptr<cpp_file> libclang_parser::do_parse(const cpp_entity_index& idx, std::string path,
-                                                    const compile_config& c) const try
+namespace
 {
-    DEBUG_ASSERT(std::strcmp(c.name(), "libclang") == 0, detail::precondition_error_handler{},
-                 "config has mismatched type");
-    auto& config = static_cast<const libclang_compile_config&>(c);
+std::size_t get_memory_usage(const detail::cxtranslation_unit& tu)
+{
+    auto usage = clang_getCXTUResourceUsage(tu.get());
 
-    // preprocess
-    auto preprocessed = detail::preprocess(config, path.c_str(), logger());
-    if (detail::libclang_compile_config_access::write_preprocessed(config))
-    {
-        std::ofstream file(path + ".pp");
-        file << preprocessed.source;
-    }
+    std::size_t result = 0u;
+    for (auto i = 0u; i != usage.numEntries; ++i)
+        result += usage.entries[i].amount;
+
+    clang_disposeCXTUResourceUsage(usage);
+    return result;
+}
 
-    // parse
-    auto tu   = get_cxunit(logger(), pimpl_->index, config, path.c_str(), preprocessed.source);
+// converts the entities of the translation unit
+std::unique_ptr<cpp_file> convert_tu(const diagnostic_logger& logger, const cpp_entity_index& idx,
+                                     const std::string& path, const detail::cxtranslation_unit& tu,
+                                     detail::preprocessor_output& preprocessed, bool use_arena,
+                                     bool share_types, bool& error)
+{
     auto file = clang_getFile(tu.get(), path.c_str());
 
-    cpp_file::builder builder(detail::cxstring(clang_getFileName(file)).std_str());
-    auto              macro_iter   = preprocessed.macros.begin();
-    auto              include_iter = preprocessed.includes.begin();
+    cpp_file::builder   builder(detail::cxstring(clang_getFileName(file)).std_str());
+    detail::arena_scope arena(use_arena ? &builder.use_arena() : nullptr);
+    auto                macro_iter   = preprocessed.macros.begin();
+    auto                include_iter = preprocessed.includes.begin();
 
     // convert entity hierarchies
+    detail::cxtoken_table tokens(tu.get(), file);
     detail::parse_context context{tu.get(),
                                   file,
-                                  type_safe::ref(logger()),
+                                  type_safe::ref(tokens),
+                                  type_safe::ref(logger),
                                   type_safe::ref(idx),
                                   detail::comment_context(preprocessed.comments),
+                                  type_safe::opt_ref(share_types ? &builder.use_type_context()
+                                                                 : nullptr),
                                   false};
     detail::visit_tu(tu, path.c_str(), [&](const CXCursor& cur) {
         if (clang_getCursorKind(cur) == CXCursor_InclusionDirective)
@@ -645,10 +1422,100 @@ std::unique_ptr<cpp_file> libclang_parser::do_parse(const cpp_entity_index& idx,
             builder.add_unmatched_comment(cpp_doc_comment(std::move(cur.comment), cur.line));
     }
 
-    if (context.error)
+    error = context.error;
+    return builder.finish(idx);
+}
+} // namespace
+
+std::unique_ptr<cpp_file> libclang_parser::do_parse(const cpp_entity_index& idx, std::string path,
+                                                    const compile_config& c) const try
+{
+    DEBUG_ASSERT(std::strcmp(c.name(), "libclang") == 0, detail::precondition_error_handler{},
+                 "config has mismatched type");
+    auto& config = static_cast<const libclang_compile_config&>(c);
+
+    // preprocess and parse
+    auto                        retain = pimpl_->is_retaining();
+    impl::index_lease           index(*pimpl_);
+    detail::cxtranslation_unit  tu;
+    detail::preprocessor_output preprocessed;
+    if (detail::libclang_compile_config_access::in_process_preprocessing(config))
+    {
+        // parse the file as is, then use the preprocessing record
+        auto source  = detail::read_source(path.c_str());
+        tu           = get_cxunit(logger(), index.get(), config, path.c_str(), source, retain);
+        preprocessed = detail::preprocess_in_process(config, path.c_str(), std::move(source), tu,
+                                                     logger());
+    }
+    else
+    {
+        preprocessed = detail::preprocess(config, path.c_str(), logger());
+        tu = get_cxunit(logger(), index.get(), config, path.c_str(), preprocessed.source,
+                        retain);
+    }
+
+    if (detail::libclang_compile_config_access::write_preprocessed(config))
+    {
+        std::ofstream file(path + ".pp");
+        file << preprocessed.source;
+    }
+
+    auto error  = false;
+    auto result = convert_tu(logger(), idx, path, tu, preprocessed, pimpl_->use_arena,
+                             pimpl_->share_types, error);
+    if (error)
         set_error();
 
-    return builder.finish(idx);
+    if (retain)
+    {
+        auto memory = get_memory_usage(tu);
+        pimpl_->retain(std::unique_ptr<impl::retained_tu>(
+            new impl::retained_tu{path, config, index.take(), std::move(tu), memory, false}));
+    }
+
+    return result;
+}
+catch (detail::parse_error& ex)
+{
+    logger().log("libclang parser", ex.get_diagnostic(path));
+    set_error();
+    return nullptr;
+}
+
+std::unique_ptr<cpp_file> libclang_parser::reparse(const cpp_entity_index& idx,
+                                                   const std::string&      path,
+                                                   const std::string&      new_contents) const try
+{
+    impl::tu_lease retained(*pimpl_, path);
+    if (!retained)
+        throw libclang_error("reparse: no translation unit retained for file '" + path + "'");
+    auto& tu = retained.get();
+
+    auto          source = detail::normalize_source(new_contents);
+    CXUnsavedFile file{path.c_str(), source.c_str(), static_cast<unsigned long>(source.length())};
+
+    auto reparse_error = clang_reparseTranslationUnit(tu.tu.get(), 1, &file,
+                                                      clang_defaultReparseOptions(tu.tu.get()));
+    if (reparse_error != 0)
+    {
+        // the translation unit is unusable now, so it isn't retained anymore
+        retained.discard();
+        throw libclang_error("clang_reparseTranslationUnit: error code "
+                             + std::to_string(reparse_error));
+    }
+    print_diagnostics(logger(), tu.tu.get());
+
+    auto preprocessed = detail::preprocess_in_process(tu.config, path.c_str(), std::move(source),
+                                                      tu.tu, logger());
+
+    auto error  = false;
+    auto result = convert_tu(logger(), idx, path, tu.tu, preprocessed, pimpl_->use_arena,
+                             pimpl_->share_types, error);
+    if (error)
+        set_error();
+
+    tu.memory = get_memory_usage(tu.tu);
+    return result;
 }
 catch (detail::parse_error& ex)
 {
@@ -206,7 +206,7 @@ std::unique_ptr<cpp_entity> detail::parse_entity(const detail::parse_context& co
     if (!clang_isAttribute(clang_getCursorKind(cur)))
     {
         // build unexposed entity
-        detail::cxtokenizer    tokenizer(context.tu, context.file, cur);
+        detail::cxtokenizer    tokenizer(*context.tokens, cur);
         detail::cxtoken_stream stream(tokenizer, cur);
         auto                   spelling = detail::to_string(stream, stream.end());
         if (spelling.begin() + 1 == spelling.end() && spelling.front().spelling == ";")
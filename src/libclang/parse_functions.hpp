@@ -6,6 +6,7 @@
 #define CPPAST_PARSE_FUNCTIONS_HPP_INCLUDED
 
 #include <cppast/cpp_entity.hpp>
+#include <cppast/cpp_type_context.hpp>
 #include <cppast/parser.hpp>
 
 #include "cxtokenizer.hpp" // for convenience
@@ -52,9 +53,12 @@ namespace detail
     {
         CXTranslationUnit                              tu;
         CXFile                                         file;
+        type_safe::object_ref<const cxtoken_table>     tokens;
         type_safe::object_ref<const diagnostic_logger> logger;
         type_safe::object_ref<const cpp_entity_index>  idx;
         comment_context                                comments;
+        // nullptr if types are not shared
+        type_safe::optional_ref<cpp_type_context>      types;
         mutable bool                                   error;
     };
 
@@ -7,16 +7,22 @@
 #include <algorithm>
 #include <atomic>
 #include <cctype>
+#include <condition_variable>
 #include <cstdio>
 #include <cstring>
 #include <fstream>
+#include <memory>
+#include <mutex>
+#include <thread>
 #include <unordered_map>
 
 #include <process.hpp>
 
 #include <cppast/diagnostic.hpp>
 
+#include "libclang_visitor.hpp"
 #include "parse_error.hpp"
+#include "scanner.hpp"
 
 using namespace cppast;
 namespace tpl = TinyProcessLib;
@@ -392,113 +398,239 @@ std::string write_macro_file(const libclang_compile_config& c, const std::string
     return file;
 }
 
-struct clang_preprocess_result
+// appends the source to the result, converts tabs to single spaces and removes carriage returns
+void append_normalized(std::string& result, const char* str, std::size_t n)
 {
-    std::string              file;
-    std::vector<std::string> included_files; // needed for pre-clang 4.0.0
+    for (auto end = str + n; str != end;)
+    {
+        auto next = detail::find_first_of<'\t', '\r'>(str, end);
+        result.append(str, next);
+        if (next == end)
+            break;
+        else if (*next == '\t')
+            result += ' ';
+        str = next + 1;
+    }
+}
+
+// the output of the preprocessor, read while the process is still running
+class preprocessor_stream
+{
+public:
+    preprocessor_stream() : finished_(false) {}
+
+    // called by the thread reading the output of the process
+    void append(const char* str, std::size_t n)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        append_normalized(incoming_, str, n);
+        available_.notify_one();
+    }
+
+    // called once the process has exited and all output was appended
+    void finish()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        finished_ = true;
+        available_.notify_one();
+    }
+
+    // the output that can be parsed
+    const std::string& buffer() const noexcept
+    {
+        return buffer_;
+    }
+
+    // removes the first consumed characters from the buffer and appends new output
+    // blocks until new output is available, returns false if there is none
+    bool read_more(std::size_t consumed)
+    {
+        buffer_.erase(0u, consumed);
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (true)
+        {
+            if (auto length = get_complete_length())
+            {
+                buffer_.append(incoming_, 0u, length);
+                incoming_.erase(0u, length);
+                return true;
+            }
+            else if (finished_)
+            {
+                if (incoming_.empty())
+                    return false;
+                buffer_ += incoming_;
+                incoming_.clear();
+                return true;
+            }
+
+            available_.wait(lock);
+        }
+    }
+
+private:
+    // returns the length of the longest prefix of the incoming output that can be parsed,
+    // i.e. it consists of complete lines and doesn't end in a comment
+    // the parser only needs to look ahead over multiple lines for comments
+    std::size_t get_complete_length() const
+    {
+        auto newline = incoming_.rfind('\n');
+        while (newline != std::string::npos)
+        {
+            // the last comment start must be closed, the buffer can't end in a comment
+            // note: this is conservative, it doesn't know about string literals
+            auto comment = incoming_.rfind("/*", newline);
+            if (comment == std::string::npos || incoming_.find("*/", comment + 2u) < newline)
+                return newline + 1u;
+
+            // try to parse everything before the comment
+            newline = comment == 0u ? std::string::npos : incoming_.rfind('\n', comment - 1u);
+        }
+        return 0u;
+    }
+
+    std::string             buffer_, incoming_;
+    std::mutex              mutex_;
+    std::condition_variable available_;
+    bool                    finished_;
 };
 
-clang_preprocess_result clang_preprocess_impl(const libclang_compile_config& c,
-                                              const diagnostic_logger&       logger,
-                                              const std::string& full_path, const char* macro_path)
+// runs the preprocessor on the file
+// its output can be read from the stream while it is still running
+class clang_preprocess_process
 {
-    clang_preprocess_result result;
+public:
+    clang_preprocess_process(const libclang_compile_config& c, const char* full_path,
+                             const diagnostic_logger& logger)
+    : logger_(logger), full_path_(full_path), exit_code_(0), expect_bad_exit_code_(false)
+    {
+        if (!std::ifstream(full_path))
+            throw libclang_error("preprocessor: file '" + std::string(full_path)
+                                 + "' doesn't exist");
+
+        // if we're fast preprocessing we only preprocess the main file, not includes
+        // this is done by disabling all include search paths when doing the preprocessing
+        // to allow macros a separate preprocessing with the -dM flag is done that extracts all
+        // macros they are then manually defined before
+        if (detail::libclang_compile_config_access::fast_preprocessing(c))
+            macro_file_ = write_macro_file(c, full_path, logger);
+
+        try
+        {
+            cmd_ = get_preprocess_command(c, full_path,
+                                          macro_file_.empty() ? nullptr : macro_file_.c_str());
+            process_.reset(new tpl::Process(cmd_, "",
+                                            [&](const char* str, std::size_t n) {
+                                                stream_.append(str, n);
+                                            },
+                                            [&](const char* str, std::size_t n) {
+                                                handle_diagnostic(str, n);
+                                            }));
+
+            // wait for the process end in the background,
+            // so the output can be parsed in the meantime
+            waiter_ = std::thread([&] {
+                exit_code_ = process_->get_exit_status();
+                stream_.finish();
+            });
+        }
+        catch (...)
+        {
+            remove_macro_file();
+            throw;
+        }
+    }
 
-    std::string diagnostic;
-    auto        expect_bad_exit_code = false;
-    auto        diagnostic_handler   = [&](const char* str, std::size_t n) {
-        diagnostic.reserve(diagnostic.size() + n);
+    clang_preprocess_process(const clang_preprocess_process&) = delete;
+    clang_preprocess_process& operator=(const clang_preprocess_process&) = delete;
+
+    ~clang_preprocess_process() noexcept
+    {
+        if (waiter_.joinable())
+        {
+            // parsing failed, don't wait for the remaining output
+            process_->kill(true);
+            waiter_.join();
+        }
+        remove_macro_file();
+    }
+
+    preprocessor_stream& stream() noexcept
+    {
+        return stream_;
+    }
+
+    // waits for the process end
+    // throws if it was not successful
+    void finish()
+    {
+        waiter_.join();
+        DEBUG_ASSERT(diagnostic_.empty(), detail::assert_handler{});
+        if (exit_code_ != 0 && !expect_bad_exit_code_)
+            throw libclang_error("preprocessor: command '" + cmd_
+                                 + "' exited with non-zero exit code ("
+                                 + std::to_string(exit_code_) + ")");
+    }
+
+private:
+    // called by the thread reading the diagnostics of the process
+    void handle_diagnostic(const char* str, std::size_t n)
+    {
+        diagnostic_.reserve(diagnostic_.size() + n);
         for (auto end = str + n; str != end; ++str)
             if (*str == '\r')
                 continue;
             else if (*str == '\n')
             {
                 // handle current diagnostic
-                if (macro_path)
+                if (!macro_file_.empty())
                 {
                     // hide diagnostics
 
-                    auto file = parse_missing_file(full_path, diagnostic);
+                    auto file = parse_missing_file(full_path_, diagnostic_);
                     if (file)
                         // save for clang without -dI flag
-                        result.included_files.push_back(file.value());
+                        included_files_.push_back(file.value());
 
-                    expect_bad_exit_code = true;
+                    expect_bad_exit_code_ = true;
                 }
                 else
-                    log_diagnostic(logger, diagnostic);
+                    log_diagnostic(logger_, diagnostic_);
 
-                diagnostic.clear();
+                diagnostic_.clear();
             }
             else
-                diagnostic.push_back(*str);
-    };
-
-    auto         cmd = get_preprocess_command(c, full_path.c_str(), macro_path);
-    tpl::Process process(cmd, "",
-                         [&](const char* str, std::size_t n) {
-                             for (auto ptr = str; ptr != str + n; ++ptr)
-                                 if (*ptr == '\t')
-                                     result.file += ' '; // convert to single spaces
-                                 else if (*ptr != '\r')
-                                     result.file += *ptr;
-                         },
-                         diagnostic_handler);
-    // wait for process end
-    auto exit_code = process.get_exit_status();
-    DEBUG_ASSERT(diagnostic.empty(), detail::assert_handler{});
-    if (exit_code != 0 && !expect_bad_exit_code)
-        throw libclang_error("preprocessor: command '" + cmd + "' exited with non-zero exit code ("
-                             + std::to_string(exit_code) + ")");
-
-    return result;
-}
-
-clang_preprocess_result clang_preprocess(const libclang_compile_config& c, const char* full_path,
-                                         const diagnostic_logger& logger)
-{
-    if (!std::ifstream(full_path))
-        throw libclang_error("preprocessor: file '" + std::string(full_path) + "' doesn't exist");
-
-    // if we're fast preprocessing we only preprocess the main file, not includes
-    // this is done by disabling all include search paths when doing the preprocessing
-    // to allow macros a separate preprocessing with the -dM flag is done that extracts all macros
-    // they are then manually defined before
-    auto fast_preprocessing = detail::libclang_compile_config_access::fast_preprocessing(c);
-
-    auto macro_file = fast_preprocessing ? write_macro_file(c, full_path, logger) : "";
-
-    clang_preprocess_result result;
-    try
-    {
-        result = clang_preprocess_impl(c, logger, full_path,
-                                       fast_preprocessing ? macro_file.c_str() : nullptr);
+                diagnostic_.push_back(*str);
     }
-    catch (...)
+
+    void remove_macro_file() noexcept
     {
-        if (fast_preprocessing)
+        if (!macro_file_.empty())
         {
-            auto err = std::remove(macro_file.c_str());
+            auto err = std::remove(macro_file_.c_str());
             DEBUG_ASSERT(err == 0, detail::assert_handler{});
+            macro_file_.clear();
         }
-        throw;
     }
 
-    if (fast_preprocessing)
-    {
-        auto err = std::remove(macro_file.c_str());
-        DEBUG_ASSERT(err == 0, detail::assert_handler{});
-    }
-
-    return result;
-}
+    const diagnostic_logger&      logger_;
+    std::string                   full_path_, macro_file_, cmd_, diagnostic_;
+    std::vector<std::string>      included_files_; // needed for pre-clang 4.0.0
+    preprocessor_stream           stream_;
+    std::unique_ptr<tpl::Process> process_;
+    std::thread                   waiter_;
+    int                           exit_code_;
+    bool                          expect_bad_exit_code_;
+};
 
 //==== parsing ===//
 class position
 {
 public:
-    position(ts::object_ref<std::string> result, const char* ptr) noexcept
-    : result_(result), cur_line_(1u), cur_column_(0u), ptr_(ptr), write_(true)
+    position(ts::object_ref<std::string> result, const std::string& source) noexcept
+    : result_(result), cur_line_(1u), cur_column_(0u), ptr_(source.c_str()),
+      end_(source.c_str() + source.size()), write_(true)
     {}
 
     void set_line(unsigned line)
@@ -513,19 +645,8 @@ public:
 
     void write_str(std::string str)
     {
-        if (write_ == false)
-            return;
-        for (auto c : str)
-        {
-            *result_ += c;
-            ++cur_column_;
-
-            if (c == '\n')
-            {
-                ++cur_line_;
-                cur_column_ = 0;
-            }
-        }
+        if (write_ == true)
+            write(str.data(), str.size());
     }
 
     void bump() noexcept
@@ -547,12 +668,8 @@ public:
     void bump(std::size_t offset) noexcept
     {
         if (write_ == true)
-        {
-            for (std::size_t i = 0u; i != offset; ++i)
-                bump();
-        }
-        else
-            skip(offset);
+            write(ptr_, offset);
+        skip(offset);
     }
 
     // no write, no newline detection
@@ -602,6 +719,19 @@ public:
         return ptr_;
     }
 
+    // the null terminator of the source
+    const char* end() const noexcept
+    {
+        return end_;
+    }
+
+    // continues at the beginning of the new source
+    void reset(const std::string& source) noexcept
+    {
+        ptr_ = source.c_str();
+        end_ = source.c_str() + source.size();
+    }
+
     unsigned cur_line() const noexcept
     {
         return cur_line_;
@@ -618,12 +748,49 @@ public:
     }
 
 private:
+    void write(const char* str, std::size_t n)
+    {
+        result_->append(str, n);
+
+        auto newlines = detail::count_newlines(str, str + n);
+        if (newlines == 0u)
+            cur_column_ += unsigned(n);
+        else
+        {
+            cur_line_ += unsigned(newlines);
+
+            auto line_begin = str + n;
+            while (line_begin[-1] != '\n')
+                --line_begin;
+            cur_column_ = unsigned(str + n - line_begin);
+        }
+    }
+
     ts::object_ref<std::string> result_;
     unsigned                    cur_line_, cur_column_;
     const char*                 ptr_;
+    const char*                 end_;
     ts::flag                    write_;
 };
 
+// reads more output of the preprocessor, p stays at the same character
+// returns false if there is no more output
+bool read_more(preprocessor_stream& stream, position& p)
+{
+    auto consumed = std::size_t(p.ptr() - stream.buffer().c_str());
+    auto result   = stream.read_more(consumed);
+    p.reset(stream.buffer());
+    return result;
+}
+
+// like std::strpbrk(p.ptr(), Chars), but vectorized
+template <char... Chars>
+const char* find_next(const position& p) noexcept
+{
+    auto next = detail::find_first_of<'\0', Chars...>(p.ptr(), p.end());
+    return *next == '\0' ? nullptr : next;
+}
+
 bool starts_with(const position& p, const char* str, std::size_t len)
 {
     return std::strncmp(p.ptr(), str, len) == 0;
@@ -1065,13 +1232,15 @@ detail::preprocessor_output detail::preprocess(const libclang_compile_config& co
     detail::preprocessor_output                  result;
     std::unordered_map<std::string, std::string> indirect_includes;
 
-    auto preprocessed = clang_preprocess(config, path, logger);
+    // parse the output while clang is still writing it
+    clang_preprocess_process process(config, path, logger);
+    auto&                    stream = process.stream();
 
-    position p(ts::ref(result.source), preprocessed.file.c_str());
+    position p(ts::ref(result.source), stream.buffer());
     ts::flag in_string(false), in_char(false), first_line(true);
-    while (p)
+    while (p || read_more(stream, p))
     {
-        auto next = std::strpbrk(p.ptr(), R"(\"'#/)"); // look for \, ", ', # or /
+        auto next = find_next<'\\', '"', '\'', '#', '/'>(p);
         if (next && next > p.ptr())
             p.bump(std::size_t(next - p.ptr() - 1)); // subtract one to get before that character
 
@@ -1189,6 +1358,8 @@ detail::preprocessor_output detail::preprocess(const libclang_compile_config& co
                     auto closing_line_marker = std::string("# 1 \"") + path + "\" 2\n";
 
                     auto ptr = std::strstr(p.ptr(), closing_line_marker.c_str());
+                    while (!ptr && read_more(stream, p))
+                        ptr = std::strstr(p.ptr(), closing_line_marker.c_str());
                     DEBUG_ASSERT(ptr, detail::assert_handler{});
                     p.skip(std::size_t(ptr - p.ptr()));
                     p.skip(closing_line_marker.size());
@@ -1213,6 +1384,7 @@ detail::preprocessor_output detail::preprocess(const libclang_compile_config& co
         else
             p.bump();
     }
+    process.finish();
 
     // get full path for indirect includes
     // doesn't work if fast preprocessing
@@ -1240,3 +1412,356 @@ detail::preprocessor_output detail::preprocess(const libclang_compile_config& co
 
     return result;
 }
+
+std::string detail::normalize_source(const std::string& contents)
+{
+    std::string result;
+    result.reserve(contents.size() + 1u);
+    append_normalized(result, contents.data(), contents.size());
+
+    if (!result.empty() && result.back() != '\n')
+        result += '\n';
+    return result;
+}
+
+std::string detail::read_source(const char* path)
+{
+    std::ifstream file(path, std::ios_base::in | std::ios_base::binary);
+    if (!file)
+        throw libclang_error("preprocessor: file '" + std::string(path) + "' doesn't exist");
+
+    return normalize_source(
+        std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>{}));
+}
+
+namespace
+{
+//=== in-process preprocessing ===//
+void get_file_location(const CXSourceLocation& loc, unsigned& line, unsigned& offset)
+{
+    clang_getFileLocation(loc, nullptr, &line, nullptr, &offset);
+}
+
+// returns the line ranges excluded by conditional compilation, sorted
+std::vector<std::pair<unsigned, unsigned>> get_skipped_lines(const CXTranslationUnit& tu,
+                                                             const CXFile&            file)
+{
+    std::vector<std::pair<unsigned, unsigned>> result;
+
+    auto ranges = clang_getSkippedRanges(tu, file);
+    if (!ranges)
+        return result;
+
+    for (auto i = 0u; i != ranges->count; ++i)
+    {
+        unsigned begin, end, offset;
+        get_file_location(clang_getRangeStart(ranges->ranges[i]), begin, offset);
+        get_file_location(clang_getRangeEnd(ranges->ranges[i]), end, offset);
+        result.emplace_back(begin, end);
+    }
+    clang_disposeSourceRangeList(ranges);
+
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+// returns the include directives of the main file,
+// the preprocessing record only contains the ones that were actually processed
+std::vector<detail::pp_include> get_includes(const detail::cxtranslation_unit& tu,
+                                             const char* path, const std::string& source)
+{
+    std::vector<detail::pp_include> result;
+    detail::visit_tu(tu, path, [&](const CXCursor& cur) {
+        if (clang_getCursorKind(cur) != CXCursor_InclusionDirective)
+            return;
+
+        unsigned line, offset;
+        get_file_location(clang_getCursorLocation(cur), line, offset);
+
+        // look at the delimiter as written
+        auto kind = cpp_include_kind::local;
+        for (auto i = std::size_t(offset); i < source.size() && source[i] != '\n'; ++i)
+            if (source[i] == '<')
+            {
+                kind = cpp_include_kind::system;
+                break;
+            }
+            else if (source[i] == '"')
+                break;
+
+        auto file_name = detail::cxstring(clang_getCursorSpelling(cur)).std_str();
+        if (file_name.size() > 2u && file_name[0] == '.'
+            && (file_name[1] == '/' || file_name[1] == '\\'))
+            file_name = file_name.substr(2);
+
+        std::string full_path;
+        if (auto file = clang_getIncludedFile(cur))
+            full_path = detail::cxstring(clang_getFileName(file)).std_str();
+
+        result.push_back({std::move(file_name), std::move(full_path), kind, line});
+    });
+    return result;
+}
+
+bool at_line_start(const std::string& written)
+{
+    for (auto iter = written.rbegin(); iter != written.rend(); ++iter)
+        if (*iter == '\n')
+            return true;
+        else if (*iter != ' ')
+            return false;
+    return true;
+}
+
+// returns the name of the directive starting at p
+std::string get_directive_name(const position& p)
+{
+    DEBUG_ASSERT(starts_with(p, "#"), detail::assert_handler{});
+
+    auto ptr = p.ptr() + 1;
+    while (*ptr == ' ')
+        ++ptr;
+
+    std::string result;
+    while (*ptr == '_' || std::isalpha(static_cast<unsigned char>(*ptr)))
+        result += *ptr++;
+    return result;
+}
+
+// bumps until the end of the logical line and returns it, joining continued lines
+// note: doesn't skip the newline
+std::string bump_logical_line(position& p)
+{
+    std::string result;
+    auto        in_c_comment = false;
+    while (p && (in_c_comment || !starts_with(p, "\n")))
+    {
+        if (starts_with(p, "\\\n"))
+        {
+            result += ' ';
+            p.bump(2u);
+        }
+        else if (!in_c_comment && starts_with(p, "/*"))
+        {
+            in_c_comment = true;
+            result += "/*";
+            p.bump(2u);
+        }
+        else if (in_c_comment && starts_with(p, "*/"))
+        {
+            in_c_comment = false;
+            result += "*/";
+            p.bump(2u);
+        }
+        else
+        {
+            result += *p.ptr();
+            p.bump();
+        }
+    }
+    return result;
+}
+
+const char* skip_directive_name(const std::string& line)
+{
+    auto ptr = line.c_str() + 1; // skip #
+    while (*ptr == ' ')
+        ++ptr;
+    while (*ptr == '_' || std::isalpha(static_cast<unsigned char>(*ptr)))
+        ++ptr;
+    while (*ptr == ' ')
+        ++ptr;
+    return ptr;
+}
+
+// normalizes the whitespace of a macro replacement like clang -E -dD does
+std::string get_replacement(const char* ptr, bool remove_comments)
+{
+    std::string result;
+    while (*ptr)
+    {
+        if (*ptr == '"' || *ptr == '\'')
+        {
+            // copy literal verbatim
+            auto quote = *ptr;
+            result += *ptr++;
+            while (*ptr && *ptr != quote)
+            {
+                if (*ptr == '\\' && ptr[1])
+                    result += *ptr++;
+                result += *ptr++;
+            }
+            if (*ptr)
+                result += *ptr++;
+        }
+        else if (remove_comments && std::strncmp(ptr, "/*", 2u) == 0)
+        {
+            auto end = std::strstr(ptr + 2, "*/");
+            ptr      = end ? end + 2 : ptr + std::strlen(ptr);
+            if (!result.empty() && result.back() != ' ')
+                result += ' ';
+        }
+        else if (remove_comments && std::strncmp(ptr, "//", 2u) == 0)
+            break;
+        else if (*ptr == ' ')
+        {
+            if (!result.empty() && result.back() != ' ')
+                result += ' ';
+            ++ptr;
+        }
+        else
+            result += *ptr++;
+    }
+
+    while (!result.empty() && result.back() == ' ')
+        result.pop_back();
+    return result;
+}
+
+std::unique_ptr<cpp_macro_definition> parse_raw_macro(position& p, bool remove_comments)
+{
+    // format: #define <name> [replacement]
+    // or: #define <name>(<args>) [replacement]
+    // note: keep macro definition in file
+    auto line = bump_logical_line(p);
+    auto ptr  = skip_directive_name(line);
+
+    std::string name;
+    while (*ptr && *ptr != '(' && *ptr != ' ')
+        name += *ptr++;
+
+    ts::optional<std::string> args;
+    if (*ptr == '(')
+    {
+        std::string str;
+        for (++ptr; *ptr && *ptr != ')'; ++ptr)
+            if (*ptr != ' ')
+                str += *ptr;
+        if (*ptr)
+            ++ptr;
+        args = std::move(str);
+    }
+
+    return build(std::move(name), std::move(args), get_replacement(ptr, remove_comments));
+}
+
+std::string parse_raw_undef(position& p)
+{
+    // format: #undef <name>
+    auto line = bump_logical_line(p);
+    auto ptr  = skip_directive_name(line);
+
+    std::string result;
+    while (*ptr && *ptr != ' ')
+        result += *ptr++;
+    return result;
+}
+} // namespace
+
+detail::preprocessor_output detail::preprocess_in_process(const libclang_compile_config& config,
+                                                          const char* path, std::string source,
+                                                          const cxtranslation_unit& tu,
+                                                          const diagnostic_logger&  logger)
+{
+    detail::preprocessor_output result;
+    result.includes = get_includes(tu, path, source);
+
+    auto skipped      = get_skipped_lines(tu.get(), clang_getFile(tu.get(), path));
+    auto skipped_iter = skipped.begin();
+    auto is_skipped   = [&](unsigned line) {
+        while (skipped_iter != skipped.end() && skipped_iter->second < line)
+            ++skipped_iter;
+        return skipped_iter != skipped.end() && skipped_iter->first <= line;
+    };
+
+    auto remove_comments = detail::libclang_compile_config_access::remove_comments_in_macro(config);
+
+    result.source.reserve(source.size());
+    position p(ts::ref(result.source), source);
+    ts::flag in_string(false), in_char(false);
+    while (p)
+    {
+        if (in_string == false && in_char == false && p.cur_column() == 0u
+            && is_skipped(p.cur_line()))
+        {
+            // inactive line, nothing of interest
+            auto newline = std::strchr(p.ptr(), '\n');
+            p.bump(std::size_t(newline - p.ptr()) + 1u);
+            continue;
+        }
+
+        auto next = find_next<'\\', '"', '\'', '#', '/', '\n'>(p);
+        if (!next)
+        {
+            p.bump(std::strlen(p.ptr()));
+            break;
+        }
+        else if (next > p.ptr())
+            p.bump(std::size_t(next - p.ptr()));
+
+        if (starts_with(p, R"(\\)") || starts_with(p, R"(\")") || starts_with(p, R"(\')"))
+            p.bump(2u);
+        else if (in_char == false && starts_with(p, R"(")"))
+        {
+            p.bump();
+            in_string.toggle();
+        }
+        else if (in_string == false && starts_with(p, "'"))
+        {
+            p.bump();
+            in_char.toggle();
+        }
+        else if (in_string == true || in_char == true)
+            p.bump();
+        else if (starts_with(p, "#") && at_line_start(result.source))
+        {
+            auto directive = get_directive_name(p);
+            if (directive == "define")
+            {
+                auto line  = p.cur_line();
+                auto macro = parse_raw_macro(p, remove_comments);
+                // match comment directly
+                if (!result.comments.empty() && result.comments.back().matches(*macro, line))
+                {
+                    macro->set_comment(std::move(result.comments.back().comment));
+                    result.comments.pop_back();
+                }
+
+                if (logger.is_verbose())
+                    logger.log("preprocessor",
+                               format_diagnostic(severity::debug,
+                                                 source_location::make_file(path, line),
+                                                 "parsing macro '", macro->name(), "'"));
+
+                result.macros.push_back({std::move(macro), line});
+            }
+            else if (directive == "undef")
+            {
+                auto undef = parse_raw_undef(p);
+                if (logger.is_verbose())
+                    logger.log("preprocessor",
+                               format_diagnostic(severity::debug,
+                                                 source_location::make_file(path, p.cur_line()),
+                                                 "undefining macro '", undef, "'"));
+
+                result.macros.erase(std::remove_if(result.macros.begin(), result.macros.end(),
+                                                   [&](const pp_macro& e) {
+                                                       return e.macro->name() == undef;
+                                                   }),
+                                    result.macros.end());
+            }
+            else
+                // other directives are kept as is,
+                // they might contain unbalanced quotes (e.g. #error)
+                bump_logical_line(p);
+        }
+        else if (skip_c_comment(p, result))
+            continue;
+        else if (skip_cpp_comment(p, result))
+            continue;
+        else
+            p.bump();
+    }
+
+    return result;
+}
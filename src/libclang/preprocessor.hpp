@@ -8,6 +8,8 @@
 #include <cppast/cpp_preprocessor.hpp>
 #include <cppast/libclang_parser.hpp>
 
+#include "raii_wrapper.hpp"
+
 namespace cppast
 {
 namespace detail
@@ -47,8 +49,23 @@ namespace detail
         std::vector<pp_doc_comment> comments;
     };
 
+    // preprocesses the file by invoking the clang binary
     preprocessor_output preprocess(const libclang_compile_config& config, const char* path,
                                    const diagnostic_logger& logger);
+
+    // returns the contents as they are passed to libclang by the in-process preprocessor
+    std::string normalize_source(const std::string& contents);
+
+    // returns the normalized contents of the file
+    std::string read_source(const char* path);
+
+    // creates the preprocessor output without invoking the clang binary
+    // tu must have been parsed from source with a detailed preprocessing record,
+    // macro invocations are not expanded in the resulting source
+    preprocessor_output preprocess_in_process(const libclang_compile_config& config,
+                                              const char* path, std::string source,
+                                              const cxtranslation_unit& tu,
+                                              const diagnostic_logger& logger);
 } // namespace detail
 } // namespace cppast
 
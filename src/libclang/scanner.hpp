@@ -0,0 +1,122 @@
+// Copyright (C) 2017-2019 Jonathan Müller <jonathanmueller.dev@gmail.com>
+// This file is subject to the license terms in the LICENSE file
+// found in the top-level directory of this distribution.
+
+#ifndef CPPAST_SCANNER_HPP_INCLUDED
+#define CPPAST_SCANNER_HPP_INCLUDED
+
+#include <cstddef>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#    define CPPAST_SCANNER_SSE2 1
+#    include <emmintrin.h>
+#else
+#    define CPPAST_SCANNER_SSE2 0
+#endif
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#    include <intrin.h>
+#endif
+
+// helper functions to scan text in blocks of 16 bytes,
+// SSE2 is part of every x86-64 CPU, so there is no need for runtime dispatch
+// other architectures use the scalar fallback
+
+namespace cppast
+{
+namespace detail
+{
+    namespace scanner_detail
+    {
+        template <char C>
+        bool is_any(char c) noexcept
+        {
+            return c == C;
+        }
+
+        template <char C1, char C2, char... Chars>
+        bool is_any(char c) noexcept
+        {
+            return c == C1 || is_any<C2, Chars...>(c);
+        }
+
+#if CPPAST_SCANNER_SSE2
+        template <char C>
+        __m128i match_any(__m128i block) noexcept
+        {
+            return _mm_cmpeq_epi8(block, _mm_set1_epi8(C));
+        }
+
+        template <char C1, char C2, char... Chars>
+        __m128i match_any(__m128i block) noexcept
+        {
+            return _mm_or_si128(match_any<C1>(block), match_any<C2, Chars...>(block));
+        }
+
+        // bit i is set if byte i matches
+        template <char... Chars>
+        unsigned match_mask(const char* ptr) noexcept
+        {
+            auto block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ptr));
+            return static_cast<unsigned>(_mm_movemask_epi8(match_any<Chars...>(block)));
+        }
+
+        // index of the lowest set bit, mask must not be zero
+        inline unsigned count_trailing_zeros(unsigned mask) noexcept
+        {
+#    if defined(_MSC_VER) && !defined(__clang__)
+            unsigned long result;
+            _BitScanForward(&result, mask);
+            return static_cast<unsigned>(result);
+#    else
+            return static_cast<unsigned>(__builtin_ctz(mask));
+#    endif
+        }
+
+        inline unsigned popcount(unsigned mask) noexcept
+        {
+#    if defined(_MSC_VER) && !defined(__clang__)
+            return __popcnt(mask);
+#    else
+            return static_cast<unsigned>(__builtin_popcount(mask));
+#    endif
+        }
+#endif
+    } // namespace scanner_detail
+
+    // returns a pointer to the first character in [ptr, end) that is one of the Chars,
+    // end if there is none
+    template <char... Chars>
+    const char* find_first_of(const char* ptr, const char* end) noexcept
+    {
+#if CPPAST_SCANNER_SSE2
+        for (; end - ptr >= 16; ptr += 16)
+        {
+            auto mask = scanner_detail::match_mask<Chars...>(ptr);
+            if (mask != 0u)
+                return ptr + scanner_detail::count_trailing_zeros(mask);
+        }
+#endif
+        for (; ptr != end; ++ptr)
+            if (scanner_detail::is_any<Chars...>(*ptr))
+                return ptr;
+        return end;
+    }
+
+    // returns the number of newlines in [ptr, end)
+    inline std::size_t count_newlines(const char* ptr, const char* end) noexcept
+    {
+        std::size_t result = 0u;
+#if CPPAST_SCANNER_SSE2
+        for (; end - ptr >= 16; ptr += 16)
+            result += scanner_detail::popcount(scanner_detail::match_mask<'\n'>(ptr));
+#endif
+        for (; ptr != end; ++ptr)
+            if (*ptr == '\n')
+                ++result;
+        return result;
+    }
+} // namespace detail
+} // namespace cppast
+
+#endif // CPPAST_SCANNER_HPP_INCLUDED
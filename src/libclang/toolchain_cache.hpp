@@ -0,0 +1,23 @@
+// Copyright (C) 2017-2019 Jonathan Müller <jonathanmueller.dev@gmail.com>
+// This file is subject to the license terms in the LICENSE file
+// found in the top-level directory of this distribution.
+
+#ifndef CPPAST_TOOLCHAIN_CACHE_HPP_INCLUDED
+#define CPPAST_TOOLCHAIN_CACHE_HPP_INCLUDED
+
+#include <cstddef>
+
+namespace cppast
+{
+namespace detail
+{
+    // number of times a clang binary has been invoked to obtain toolchain information
+    std::size_t toolchain_probe_count();
+
+    // discards the toolchain information cached in memory,
+    // and loads the one persisted in the toolchain cache file again, if there is one
+    void clear_toolchain_cache();
+} // namespace detail
+} // namespace cppast
+
+#endif // CPPAST_TOOLCHAIN_CACHE_HPP_INCLUDED
@@ -683,6 +683,8 @@ std::unique_ptr<cpp_type> detail::parse_type(const detail::parse_context& contex
 {
     auto result = parse_type_impl(context, cur, type);
     DEBUG_ASSERT(result != nullptr, detail::parse_error_handler{}, type, "invalid type");
+    if (context.types)
+        context.types.value().share_subtypes(*result);
     return result;
 }
 
@@ -716,7 +718,7 @@ std::unique_ptr<cpp_entity> detail::parse_cpp_type_alias(const detail::parse_con
     }
 
     // look for attributes
-    detail::cxtokenizer    tokenizer(context.tu, context.file, cur);
+    detail::cxtokenizer    tokenizer(*context.tokens, cur);
     detail::cxtoken_stream stream(tokenizer, cur);
     if (detail::skip_if(stream, "using"))
     {
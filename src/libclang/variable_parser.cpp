@@ -15,7 +15,7 @@ std::unique_ptr<cpp_expression> detail::parse_default_value(cpp_attribute_list&
                                                             const detail::parse_context& context,
                                                             const CXCursor& cur, const char* name)
 {
-    detail::cxtokenizer    tokenizer(context.tu, context.file, cur);
+    detail::cxtokenizer    tokenizer(*context.tokens, cur);
     detail::cxtoken_stream stream(tokenizer, cur);
 
     auto has_default = false;
@@ -61,7 +61,7 @@ std::unique_ptr<cpp_entity> detail::parse_cpp_variable(const detail::parse_conte
 
     // just look for thread local or constexpr
     // can't appear anywhere else, so good enough
-    detail::cxtokenizer tokenizer(context.tu, context.file, cur);
+    detail::cxtokenizer tokenizer(*context.tokens, cur);
     for (auto& token : tokenizer)
         if (token.value() == "thread_local")
             storage_class
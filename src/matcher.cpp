@@ -0,0 +1,648 @@
+// Copyright (C) 2017-2019 Jonathan Müller <jonathanmueller.dev@gmail.com>
+// This file is subject to the license terms in the LICENSE file
+// found in the top-level directory of this distribution.
+
+#include <cppast/matcher.hpp>
+
+#include <initializer_list>
+
+#include <cppast/cpp_function.hpp>
+#include <cppast/cpp_member_function.hpp>
+#include <cppast/cpp_member_variable.hpp>
+#include <cppast/cpp_type_alias.hpp>
+#include <cppast/cpp_variable.hpp>
+#include <cppast/visitor.hpp>
+
+using namespace cppast;
+
+struct detail::matcher_access
+{
+    template <class Node, typename... Args>
+    static entity_matcher make_entity_matcher(Args&&... args)
+    {
+        return entity_matcher(std::make_shared<Node>(std::forward<Args>(args)...));
+    }
+
+    template <class Node, typename... Args>
+    static type_matcher make_type_matcher(Args&&... args)
+    {
+        return type_matcher(std::make_shared<Node>(std::forward<Args>(args)...));
+    }
+
+    static const entity_matcher_node& get_node(const entity_matcher& matcher) noexcept
+    {
+        return *matcher.node_;
+    }
+
+    static const type_matcher_node& get_node(const type_matcher& matcher) noexcept
+    {
+        return *matcher.node_;
+    }
+};
+
+namespace
+{
+using detail::matcher_access;
+
+detail::entity_kind_set all_kinds() noexcept
+{
+    return detail::entity_kind_set().set();
+}
+
+detail::entity_kind_set kinds_of(std::initializer_list<cpp_entity_kind> kinds) noexcept
+{
+    detail::entity_kind_set result;
+    for (auto kind : kinds)
+        result.set(std::size_t(kind));
+    return result;
+}
+
+//=== entity matchers ===//
+class any_entity_node final : public detail::entity_matcher_node
+{
+public:
+    any_entity_node() : entity_matcher_node(all_kinds()) {}
+
+private:
+    bool do_matches(const cpp_entity&, detail::match_bindings&) const override
+    {
+        return true;
+    }
+};
+
+class kind_node final : public detail::entity_matcher_node
+{
+public:
+    explicit kind_node(cpp_entity_kind kind) : entity_matcher_node(kinds_of({kind})), kind_(kind)
+    {}
+
+private:
+    bool do_matches(const cpp_entity& e, detail::match_bindings&) const override
+    {
+        return e.kind() == kind_;
+    }
+
+    cpp_entity_kind kind_;
+};
+
+class name_node final : public detail::entity_matcher_node
+{
+public:
+    explicit name_node(std::string name) : entity_matcher_node(all_kinds()), name_(std::move(name))
+    {}
+
+private:
+    bool do_matches(const cpp_entity& e, detail::match_bindings&) const override
+    {
+        return e.name() == name_;
+    }
+
+    std::string name_;
+};
+
+class attribute_name_node final : public detail::entity_matcher_node
+{
+public:
+    explicit attribute_name_node(std::string name)
+    : entity_matcher_node(all_kinds()), name_(std::move(name))
+    {}
+
+private:
+    bool do_matches(const cpp_entity& e, detail::match_bindings&) const override
+    {
+        return cppast::has_attribute(e, name_).has_value();
+    }
+
+    std::string name_;
+};
+
+class attribute_kind_node final : public detail::entity_matcher_node
+{
+public:
+    explicit attribute_kind_node(cpp_attribute_kind kind)
+    : entity_matcher_node(all_kinds()), kind_(kind)
+    {}
+
+private:
+    bool do_matches(const cpp_entity& e, detail::match_bindings&) const override
+    {
+        return cppast::has_attribute(e, kind_).has_value();
+    }
+
+    cpp_attribute_kind kind_;
+};
+
+class parent_node final : public detail::entity_matcher_node
+{
+public:
+    explicit parent_node(entity_matcher parent)
+    : entity_matcher_node(all_kinds()), parent_(std::move(parent))
+    {}
+
+private:
+    bool do_matches(const cpp_entity& e, detail::match_bindings& bindings) const override
+    {
+        return e.parent()
+               && matcher_access::get_node(parent_).matches(e.parent().value(), bindings);
+    }
+
+    entity_matcher parent_;
+};
+
+class ancestor_node final : public detail::entity_matcher_node
+{
+public:
+    explicit ancestor_node(entity_matcher ancestor)
+    : entity_matcher_node(all_kinds()), ancestor_(std::move(ancestor))
+    {}
+
+private:
+    bool do_matches(const cpp_entity& e, detail::match_bindings& bindings) const override
+    {
+        auto& node = matcher_access::get_node(ancestor_);
+        for (auto cur = e.parent(); cur; cur = cur.value().parent())
+        {
+            auto& ancestor = cur.value();
+            if (node.kinds()[std::size_t(ancestor.kind())] && node.matches(ancestor, bindings))
+                return true;
+        }
+        return false;
+    }
+
+    entity_matcher ancestor_;
+};
+
+type_safe::optional_ref<const cpp_type> get_type(const cpp_entity& e) noexcept
+{
+    switch (e.kind())
+    {
+    case cpp_entity_kind::variable_t:
+        return type_safe::ref(static_cast<const cpp_variable&>(e).type());
+    case cpp_entity_kind::member_variable_t:
+    case cpp_entity_kind::bitfield_t:
+        return type_safe::ref(static_cast<const cpp_member_variable_base&>(e).type());
+    case cpp_entity_kind::function_parameter_t:
+        return type_safe::ref(static_cast<const cpp_function_parameter&>(e).type());
+    case cpp_entity_kind::type_alias_t:
+        return type_safe::ref(static_cast<const cpp_type_alias&>(e).underlying_type());
+    case cpp_entity_kind::function_t:
+        return type_safe::ref(static_cast<const cpp_function&>(e).return_type());
+    case cpp_entity_kind::member_function_t:
+    case cpp_entity_kind::conversion_op_t:
+        return type_safe::ref(static_cast<const cpp_member_function_base&>(e).return_type());
+
+    default:
+        break;
+    }
+
+    return nullptr;
+}
+
+class type_node final : public detail::entity_matcher_node
+{
+public:
+    explicit type_node(type_matcher type)
+    : entity_matcher_node(kinds_of({cpp_entity_kind::variable_t, cpp_entity_kind::member_variable_t,
+                                    cpp_entity_kind::bitfield_t,
+                                    cpp_entity_kind::function_parameter_t,
+                                    cpp_entity_kind::type_alias_t, cpp_entity_kind::function_t,
+                                    cpp_entity_kind::member_function_t,
+                                    cpp_entity_kind::conversion_op_t})),
+      type_(std::move(type))
+    {}
+
+private:
+    bool do_matches(const cpp_entity& e, detail::match_bindings&) const override
+    {
+        auto type = get_type(e);
+        return type && type_.matches(type.value());
+    }
+
+    type_matcher type_;
+};
+
+class all_of_node final : public detail::entity_matcher_node
+{
+public:
+    explicit all_of_node(std::vector<entity_matcher> matchers)
+    : entity_matcher_node(common_kinds(matchers)), matchers_(std::move(matchers))
+    {}
+
+private:
+    static detail::entity_kind_set common_kinds(const std::vector<entity_matcher>& matchers)
+    {
+        auto result = all_kinds();
+        for (auto& matcher : matchers)
+            result &= matcher_access::get_node(matcher).kinds();
+        return result;
+    }
+
+    bool do_matches(const cpp_entity& e, detail::match_bindings& bindings) const override
+    {
+        for (auto& matcher : matchers_)
+            if (!matcher_access::get_node(matcher).matches(e, bindings))
+                return false;
+        return true;
+    }
+
+    std::vector<entity_matcher> matchers_;
+};
+
+class any_of_node final : public detail::entity_matcher_node
+{
+public:
+    explicit any_of_node(std::vector<entity_matcher> matchers)
+    : entity_matcher_node(combined_kinds(matchers)), matchers_(std::move(matchers))
+    {}
+
+private:
+    static detail::entity_kind_set combined_kinds(const std::vector<entity_matcher>& matchers)
+    {
+        detail::entity_kind_set result;
+        for (auto& matcher : matchers)
+            result |= matcher_access::get_node(matcher).kinds();
+        return result;
+    }
+
+    bool do_matches(const cpp_entity& e, detail::match_bindings& bindings) const override
+    {
+        for (auto& matcher : matchers_)
+            if (matcher_access::get_node(matcher).matches(e, bindings))
+                return true;
+        return false;
+    }
+
+    std::vector<entity_matcher> matchers_;
+};
+
+class unless_node final : public detail::entity_matcher_node
+{
+public:
+    explicit unless_node(entity_matcher matcher)
+    : entity_matcher_node(all_kinds()), matcher_(std::move(matcher))
+    {}
+
+private:
+    bool do_matches(const cpp_entity& e, detail::match_bindings&) const override
+    {
+        detail::match_bindings ignored;
+        return !matcher_access::get_node(matcher_).matches(e, ignored);
+    }
+
+    entity_matcher matcher_;
+};
+
+class bind_node final : public detail::entity_matcher_node
+{
+public:
+    explicit bind_node(std::string id, entity_matcher matcher)
+    : entity_matcher_node(matcher_access::get_node(matcher).kinds()), id_(std::move(id)),
+      matcher_(std::move(matcher))
+    {}
+
+private:
+    bool do_matches(const cpp_entity& e, detail::match_bindings& bindings) const override
+    {
+        if (!matcher_access::get_node(matcher_).matches(e, bindings))
+            return false;
+        bindings.emplace_back(&id_, &e);
+        return true;
+    }
+
+    std::string    id_;
+    entity_matcher matcher_;
+};
+
+//=== type matchers ===//
+class any_type_node final : public detail::type_matcher_node
+{
+public:
+    bool matches(const cpp_type&) const override
+    {
+        return true;
+    }
+};
+
+class type_kind_node final : public detail::type_matcher_node
+{
+public:
+    explicit type_kind_node(cpp_type_kind kind) : kind_(kind) {}
+
+    bool matches(const cpp_type& type) const override
+    {
+        return type.kind() == kind_;
+    }
+
+private:
+    cpp_type_kind kind_;
+};
+
+class builtin_node final : public detail::type_matcher_node
+{
+public:
+    explicit builtin_node(cpp_builtin_type_kind kind) : kind_(kind) {}
+
+    bool matches(const cpp_type& type) const override
+    {
+        return type.kind() == cpp_type_kind::builtin_t
+               && static_cast<const cpp_builtin_type&>(type).builtin_type_kind() == kind_;
+    }
+
+private:
+    cpp_builtin_type_kind kind_;
+};
+
+class spelling_node final : public detail::type_matcher_node
+{
+public:
+    explicit spelling_node(std::string spelling) : spelling_(std::move(spelling)) {}
+
+    bool matches(const cpp_type& type) const override
+    {
+        return to_string(type) == spelling_;
+    }
+
+private:
+    std::string spelling_;
+};
+
+class const_node final : public detail::type_matcher_node
+{
+public:
+    bool matches(const cpp_type& type) const override
+    {
+        return type.kind() == cpp_type_kind::cv_qualified_t
+               && cppast::is_const(static_cast<const cpp_cv_qualified_type&>(type).cv_qualifier());
+    }
+};
+
+class ignoring_cv_node final : public detail::type_matcher_node
+{
+public:
+    explicit ignoring_cv_node(type_matcher type) : type_(std::move(type)) {}
+
+    bool matches(const cpp_type& type) const override
+    {
+        return type_.matches(remove_cv(type));
+    }
+
+private:
+    type_matcher type_;
+};
+
+class pointee_node final : public detail::type_matcher_node
+{
+public:
+    explicit pointee_node(type_matcher pointee) : pointee_(std::move(pointee)) {}
+
+    bool matches(const cpp_type& type) const override
+    {
+        return type.kind() == cpp_type_kind::pointer_t
+               && pointee_.matches(static_cast<const cpp_pointer_type&>(type).pointee());
+    }
+
+private:
+    type_matcher pointee_;
+};
+
+class referee_node final : public detail::type_matcher_node
+{
+public:
+    explicit referee_node(type_matcher referee) : referee_(std::move(referee)) {}
+
+    bool matches(const cpp_type& type) const override
+    {
+        return type.kind() == cpp_type_kind::reference_t
+               && referee_.matches(static_cast<const cpp_reference_type&>(type).referee());
+    }
+
+private:
+    type_matcher referee_;
+};
+
+class type_all_of_node final : public detail::type_matcher_node
+{
+public:
+    explicit type_all_of_node(std::vector<type_matcher> matchers) : matchers_(std::move(matchers))
+    {}
+
+    bool matches(const cpp_type& type) const override
+    {
+        for (auto& matcher : matchers_)
+            if (!matcher.matches(type))
+                return false;
+        return true;
+    }
+
+private:
+    std::vector<type_matcher> matchers_;
+};
+
+class type_any_of_node final : public detail::type_matcher_node
+{
+public:
+    explicit type_any_of_node(std::vector<type_matcher> matchers) : matchers_(std::move(matchers))
+    {}
+
+    bool matches(const cpp_type& type) const override
+    {
+        for (auto& matcher : matchers_)
+            if (matcher.matches(type))
+                return true;
+        return false;
+    }
+
+private:
+    std::vector<type_matcher> matchers_;
+};
+
+class type_unless_node final : public detail::type_matcher_node
+{
+public:
+    explicit type_unless_node(type_matcher matcher) : matcher_(std::move(matcher)) {}
+
+    bool matches(const cpp_type& type) const override
+    {
+        return !matcher_.matches(type);
+    }
+
+private:
+    type_matcher matcher_;
+};
+} // namespace
+
+entity_matcher entity_matcher::bind(std::string id) const
+{
+    return matcher_access::make_entity_matcher<bind_node>(std::move(id), *this);
+}
+
+bool entity_matcher::matches(const cpp_entity& e) const
+{
+    detail::match_bindings ignored;
+    return node_->matches(e, ignored);
+}
+
+entity_matcher detail::make_all_of(std::vector<entity_matcher> matchers)
+{
+    return matcher_access::make_entity_matcher<all_of_node>(std::move(matchers));
+}
+
+entity_matcher detail::make_any_of(std::vector<entity_matcher> matchers)
+{
+    return matcher_access::make_entity_matcher<any_of_node>(std::move(matchers));
+}
+
+type_matcher detail::make_all_of(std::vector<type_matcher> matchers)
+{
+    return matcher_access::make_type_matcher<type_all_of_node>(std::move(matchers));
+}
+
+type_matcher detail::make_any_of(std::vector<type_matcher> matchers)
+{
+    return matcher_access::make_type_matcher<type_any_of_node>(std::move(matchers));
+}
+
+entity_matcher matchers::any_entity()
+{
+    return matcher_access::make_entity_matcher<any_entity_node>();
+}
+
+entity_matcher matchers::is_kind(cpp_entity_kind kind)
+{
+    return matcher_access::make_entity_matcher<kind_node>(kind);
+}
+
+entity_matcher matchers::has_name(std::string name)
+{
+    return matcher_access::make_entity_matcher<name_node>(std::move(name));
+}
+
+entity_matcher matchers::has_attribute(std::string name)
+{
+    return matcher_access::make_entity_matcher<attribute_name_node>(std::move(name));
+}
+
+entity_matcher matchers::has_attribute(cpp_attribute_kind kind)
+{
+    return matcher_access::make_entity_matcher<attribute_kind_node>(kind);
+}
+
+entity_matcher matchers::has_parent(entity_matcher parent)
+{
+    return matcher_access::make_entity_matcher<parent_node>(std::move(parent));
+}
+
+entity_matcher matchers::has_ancestor(entity_matcher ancestor)
+{
+    return matcher_access::make_entity_matcher<ancestor_node>(std::move(ancestor));
+}
+
+entity_matcher matchers::has_type(type_matcher type)
+{
+    return matcher_access::make_entity_matcher<type_node>(std::move(type));
+}
+
+entity_matcher matchers::unless(entity_matcher matcher)
+{
+    return matcher_access::make_entity_matcher<unless_node>(std::move(matcher));
+}
+
+type_matcher matchers::any_type()
+{
+    return matcher_access::make_type_matcher<any_type_node>();
+}
+
+type_matcher matchers::is_type_kind(cpp_type_kind kind)
+{
+    return matcher_access::make_type_matcher<type_kind_node>(kind);
+}
+
+type_matcher matchers::is_builtin(cpp_builtin_type_kind kind)
+{
+    return matcher_access::make_type_matcher<builtin_node>(kind);
+}
+
+type_matcher matchers::has_spelling(std::string spelling)
+{
+    return matcher_access::make_type_matcher<spelling_node>(std::move(spelling));
+}
+
+type_matcher matchers::is_const()
+{
+    return matcher_access::make_type_matcher<const_node>();
+}
+
+type_matcher matchers::ignoring_cv(type_matcher type)
+{
+    return matcher_access::make_type_matcher<ignoring_cv_node>(std::move(type));
+}
+
+type_matcher matchers::points_to(type_matcher pointee)
+{
+    return matcher_access::make_type_matcher<pointee_node>(std::move(pointee));
+}
+
+type_matcher matchers::references(type_matcher referee)
+{
+    return matcher_access::make_type_matcher<referee_node>(std::move(referee));
+}
+
+type_matcher matchers::unless(type_matcher matcher)
+{
+    return matcher_access::make_type_matcher<type_unless_node>(std::move(matcher));
+}
+
+type_safe::optional_ref<const cpp_entity> match_result::get(const std::string& id) const noexcept
+{
+    for (auto& binding : *bindings_)
+        if (*binding.first == id)
+            return type_safe::ref(*binding.second);
+    return nullptr;
+}
+
+void match_finder::add(entity_matcher matcher, callback cb)
+{
+    // add the query first, so the buckets never refer to a query that doesn't exist
+    queries_.emplace_back(std::move(matcher), std::move(cb));
+
+    auto  index = queries_.size() - 1u;
+    auto& kinds = matcher_access::get_node(queries_.back().matcher).kinds();
+    try
+    {
+        for (auto i = 0u; i != kinds.size(); ++i)
+            if (kinds[i])
+                by_kind_[i].push_back(index);
+    }
+    catch (...)
+    {
+        for (auto& bucket : by_kind_)
+            if (!bucket.empty() && bucket.back() == index)
+                bucket.pop_back();
+        queries_.pop_back();
+        throw;
+    }
+}
+
+void match_finder::match(const cpp_entity& e) const
+{
+    if (queries_.empty())
+        return;
+
+    detail::match_bindings bindings;
+    for (ast_cursor cursor(e); !cursor.done(); cursor.next())
+    {
+        if (cursor.info().is_old_entity())
+            continue;
+
+        // only evaluate the matchers that can match the kind at all
+        auto& cur = cursor.entity();
+        for (auto index : by_kind_[std::size_t(cur.kind())])
+        {
+            auto& query = queries_[index];
+
+            bindings.clear();
+            if (matcher_access::get_node(query.matcher).matches(cur, bindings))
+                query.cb(match_result(cur, bindings));
+        }
+    }
+}
@@ -0,0 +1,75 @@
+// Copyright (C) 2017-2019 Jonathan Müller <jonathanmueller.dev@gmail.com>
+// This file is subject to the license terms in the LICENSE file
+// found in the top-level directory of this distribution.
+
+#include <cppast/parallel_visitor.hpp>
+
+#include <cppast/cpp_file.hpp>
+#include <cppast/cpp_language_linkage.hpp>
+#include <cppast/cpp_namespace.hpp>
+
+using namespace cppast;
+
+namespace
+{
+void schedule(detail::thread_pool& pool, const cpp_entity& e, detail::visitor_callback_t cb,
+              void* functor, bool last_child);
+
+template <typename T>
+void schedule_children(detail::thread_pool& pool, const cpp_entity& e,
+                       detail::visitor_callback_t cb, void* functor, bool last_child)
+{
+    auto& container = static_cast<const T&>(e);
+    if (!cb(functor, container, {visitor_info::container_entity_enter, cpp_public, last_child}))
+        return;
+
+    // the children of all those containers are public
+    for (auto iter = container.begin(); iter != container.end();)
+    {
+        auto& cur = *iter;
+        ++iter;
+        schedule(pool, cur, cb, functor, iter == container.end());
+    }
+}
+
+void visit_subtree(detail::thread_pool& pool, const cpp_entity& e, detail::visitor_callback_t cb,
+                   void* functor, bool last_child)
+{
+    switch (e.kind())
+    {
+    case cpp_entity_kind::file_t:
+        schedule_children<cpp_file>(pool, e, cb, functor, last_child);
+        break;
+    case cpp_entity_kind::namespace_t:
+        schedule_children<cpp_namespace>(pool, e, cb, functor, last_child);
+        break;
+    case cpp_entity_kind::language_linkage_t:
+        schedule_children<cpp_language_linkage>(pool, e, cb, functor, last_child);
+        break;
+
+    default:
+        detail::visit(e, cb, functor, cpp_public, last_child);
+        break;
+    }
+}
+
+void schedule(detail::thread_pool& pool, const cpp_entity& e, detail::visitor_callback_t cb,
+              void* functor, bool last_child)
+{
+    // if called from a worker, the task goes into its own queue, so idle workers steal big subtrees
+    auto pool_ptr = &pool;
+    auto entity   = &e;
+    pool.submit([pool_ptr, entity, cb, functor, last_child] {
+        visit_subtree(*pool_ptr, *entity, cb, functor, last_child);
+    });
+}
+} // namespace
+
+void detail::parallel_visit(thread_pool& pool, const cpp_entity& e, visitor_callback_t cb,
+                            void* functor, bool split_namespaces)
+{
+    if (split_namespaces)
+        schedule(pool, e, cb, functor, false);
+    else
+        pool.submit([&e, cb, functor] { detail::visit(e, cb, functor, cpp_public, false); });
+}
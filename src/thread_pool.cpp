@@ -0,0 +1,182 @@
+// Copyright (C) 2017-2019 Jonathan Müller <jonathanmueller.dev@gmail.com>
+// This file is subject to the license terms in the LICENSE file
+// found in the top-level directory of this distribution.
+
+#include <cppast/detail/thread_pool.hpp>
+
+using namespace cppast;
+
+namespace
+{
+// the pool and queue index of the current worker thread, if any
+thread_local const detail::thread_pool* current_pool  = nullptr;
+thread_local std::size_t                current_queue = 0u;
+} // namespace
+
+unsigned detail::thread_pool::default_size() noexcept
+{
+    auto result = std::thread::hardware_concurrency();
+    return result == 0u ? 1u : result;
+}
+
+detail::thread_pool::thread_pool(unsigned no_workers)
+: queued_(0u), unfinished_(0u), next_queue_(0u), stop_(false)
+{
+    if (no_workers == 0u)
+        no_workers = default_size();
+
+    queues_.reserve(no_workers);
+    for (auto i = 0u; i != no_workers; ++i)
+        queues_.emplace_back(new queue);
+
+    workers_.reserve(no_workers);
+    for (auto i = 0u; i != no_workers; ++i)
+        workers_.emplace_back(&thread_pool::run_worker, this, std::size_t(i));
+}
+
+detail::thread_pool::~thread_pool() noexcept
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    work_available_.notify_all();
+
+    for (auto& worker : workers_)
+        worker.join();
+}
+
+void detail::thread_pool::submit(task t)
+{
+    std::size_t index;
+    {
+        // count before pushing, so a thief never decrements a counter that wasn't incremented yet
+        std::lock_guard<std::mutex> lock(mutex_);
+        ++queued_;
+        ++unfinished_;
+
+        if (current_pool == this)
+            index = current_queue;
+        else
+        {
+            index       = next_queue_;
+            next_queue_ = (next_queue_ + 1u) % queues_.size();
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(queues_[index]->mutex);
+        queues_[index]->tasks.push_back(std::move(t));
+    }
+    work_available_.notify_one();
+    // a waiting thread might help as well
+    work_done_.notify_one();
+}
+
+void detail::thread_pool::wait()
+{
+    auto index = current_pool == this ? current_queue : std::size_t(0u);
+    while (true)
+    {
+        task t;
+        if (try_pop(index, t) || try_steal(index, t))
+            execute(t);
+        else
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            work_done_.wait(lock, [&] { return unfinished_ == 0u || queued_ > 0u; });
+            if (unfinished_ == 0u)
+                break;
+        }
+    }
+
+    std::exception_ptr exception;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::swap(exception, exception_);
+    }
+    if (exception)
+        std::rethrow_exception(exception);
+}
+
+std::size_t detail::thread_pool::current_worker() const noexcept
+{
+    return current_pool == this ? current_queue : workers_.size();
+}
+
+void detail::thread_pool::run_worker(std::size_t index)
+{
+    current_pool  = this;
+    current_queue = index;
+
+    while (true)
+    {
+        task t;
+        if (try_pop(index, t) || try_steal(index, t))
+            execute(t);
+        else
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            work_available_.wait(lock, [&] { return stop_ || queued_ > 0u; });
+            if (stop_ && queued_ == 0u)
+                break;
+        }
+    }
+}
+
+bool detail::thread_pool::try_pop(std::size_t index, task& t)
+{
+    auto& q = *queues_[index];
+
+    std::lock_guard<std::mutex> lock(q.mutex);
+    if (q.tasks.empty())
+        return false;
+    t = std::move(q.tasks.back());
+    q.tasks.pop_back();
+    return true;
+}
+
+bool detail::thread_pool::try_steal(std::size_t index, task& t)
+{
+    for (auto i = 1u; i < queues_.size(); ++i)
+    {
+        auto& q = *queues_[(index + i) % queues_.size()];
+
+        std::lock_guard<std::mutex> lock(q.mutex);
+        if (!q.tasks.empty())
+        {
+            t = std::move(q.tasks.front());
+            q.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+void detail::thread_pool::execute(task& t)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        --queued_;
+    }
+
+    std::exception_ptr exception;
+    try
+    {
+        t();
+    }
+    catch (...)
+    {
+        exception = std::current_exception();
+    }
+
+    auto done = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (exception && !exception_)
+            exception_ = exception;
+        done = --unfinished_ == 0u;
+    }
+    if (done)
+        work_done_.notify_all();
+}
@@ -33,62 +33,49 @@ void update_access(cpp_access_specifier_kind& child_access, const cpp_entity& ch
         child_access = static_cast<const cpp_access_specifier&>(child).access_specifier();
 }
 
+using get_child_t = const cpp_entity& (*)(const cpp_entity&, std::size_t);
+
 template <typename T>
-bool handle_container(const cpp_entity& e, detail::visitor_callback_t cb, void* functor,
-                      cpp_access_specifier_kind cur_access, bool last_child)
+const cpp_entity& get_child(const cpp_entity& e, std::size_t i)
 {
-    auto& container = static_cast<const T&>(e);
-
-    auto handle_children
-        = cb(functor, container, {visitor_info::container_entity_enter, cur_access, last_child});
-    if (handle_children)
-    {
-        auto child_access = get_initial_access(e);
-        for (auto iter = container.begin(); iter != container.end();)
-        {
-            auto& cur = *iter;
-            ++iter;
-
-            update_access(child_access, cur);
-
-            if (!detail::visit(cur, cb, functor, child_access, iter == container.end()))
-                return false;
-        }
-    }
+    return static_cast<const T&>(e).begin()[std::ptrdiff_t(i)];
+}
 
-    return cb(functor, container, {visitor_info::container_entity_exit, cur_access, last_child});
+template <typename T>
+get_child_t get_children(const cpp_entity& e, std::size_t& size)
+{
+    auto& container = static_cast<const T&>(e);
+    size            = std::size_t(container.end() - container.begin());
+    return &get_child<T>;
 }
-} // namespace
 
-bool detail::visit(const cpp_entity& e, detail::visitor_callback_t cb, void* functor,
-                   cpp_access_specifier_kind cur_access, bool last_child)
+// returns nullptr if the entity isn't a container
+get_child_t get_children(const cpp_entity& e, std::size_t& size)
 {
     switch (e.kind())
     {
     case cpp_entity_kind::file_t:
-        return handle_container<cpp_file>(e, cb, functor, cur_access, last_child);
+        return get_children<cpp_file>(e, size);
     case cpp_entity_kind::language_linkage_t:
-        return handle_container<cpp_language_linkage>(e, cb, functor, cur_access, last_child);
+        return get_children<cpp_language_linkage>(e, size);
     case cpp_entity_kind::namespace_t:
-        return handle_container<cpp_namespace>(e, cb, functor, cur_access, last_child);
+        return get_children<cpp_namespace>(e, size);
     case cpp_entity_kind::enum_t:
-        return handle_container<cpp_enum>(e, cb, functor, cur_access, last_child);
+        return get_children<cpp_enum>(e, size);
     case cpp_entity_kind::class_t:
-        return handle_container<cpp_class>(e, cb, functor, cur_access, last_child);
+        return get_children<cpp_class>(e, size);
     case cpp_entity_kind::alias_template_t:
-        return handle_container<cpp_alias_template>(e, cb, functor, cur_access, last_child);
+        return get_children<cpp_alias_template>(e, size);
     case cpp_entity_kind::variable_template_t:
-        return handle_container<cpp_variable_template>(e, cb, functor, cur_access, last_child);
+        return get_children<cpp_variable_template>(e, size);
     case cpp_entity_kind::function_template_t:
-        return handle_container<cpp_function_template>(e, cb, functor, cur_access, last_child);
+        return get_children<cpp_function_template>(e, size);
     case cpp_entity_kind::function_template_specialization_t:
-        return handle_container<cpp_function_template_specialization>(e, cb, functor, cur_access,
-                                                                      last_child);
+        return get_children<cpp_function_template_specialization>(e, size);
     case cpp_entity_kind::class_template_t:
-        return handle_container<cpp_class_template>(e, cb, functor, cur_access, last_child);
+        return get_children<cpp_class_template>(e, size);
     case cpp_entity_kind::class_template_specialization_t:
-        return handle_container<cpp_class_template_specialization>(e, cb, functor, cur_access,
-                                                                   last_child);
+        return get_children<cpp_class_template_specialization>(e, size);
 
     case cpp_entity_kind::macro_parameter_t:
     case cpp_entity_kind::macro_definition_t:
@@ -115,12 +102,85 @@ bool detail::visit(const cpp_entity& e, detail::visitor_callback_t cb, void* fun
     case cpp_entity_kind::template_template_parameter_t:
     case cpp_entity_kind::static_assert_t:
     case cpp_entity_kind::unexposed_t:
-        return cb(functor, e, {visitor_info::leaf_entity, cur_access, last_child});
+        return nullptr;
 
     case cpp_entity_kind::count:
         break;
     }
 
     DEBUG_UNREACHABLE(detail::assert_handler{});
-    return true;
+    return nullptr;
+}
+} // namespace
+
+ast_cursor::ast_cursor(const cpp_entity& e, cpp_access_specifier_kind access, bool last_child)
+: aborted_(false)
+{
+    set_current(e, access, last_child);
+}
+
+void ast_cursor::advance(bool result)
+{
+    DEBUG_ASSERT(!done(), detail::precondition_error_handler{}, "cursor is done");
+    if (info_.event == visitor_info::container_entity_enter)
+    {
+        if (!result)
+        {
+            // go directly to the exit event
+            info_.event = visitor_info::container_entity_exit;
+            return;
+        }
+
+        stack_.push_back({cur_, get_child_, 0u, no_children_, info_.access,
+                          get_initial_access(*cur_), info_.last_child});
+    }
+    else if (!result)
+    {
+        abort();
+        return;
+    }
+    else if (stack_.empty())
+    {
+        // finished the initial entity
+        cur_ = nullptr;
+        return;
+    }
+
+    next_child();
+}
+
+void ast_cursor::set_current(const cpp_entity& e, cpp_access_specifier_kind access,
+                             bool last_child)
+{
+    cur_       = &e;
+    get_child_ = get_children(e, no_children_);
+
+    auto event = get_child_ ? visitor_info::container_entity_enter : visitor_info::leaf_entity;
+    info_      = {event, access, last_child};
+}
+
+void ast_cursor::next_child()
+{
+    auto& top = stack_.back();
+    if (top.next == top.size)
+    {
+        cur_  = top.container;
+        info_ = {visitor_info::container_entity_exit, top.access, top.last_child};
+        stack_.pop_back();
+    }
+    else
+    {
+        auto& child = top.get_child(*top.container, top.next++);
+        update_access(top.child_access, child);
+        set_current(child, top.child_access, top.next == top.size);
+    }
+}
+
+bool detail::visit(const cpp_entity& e, detail::visitor_callback_t cb, void* functor,
+                   cpp_access_specifier_kind cur_access, bool last_child)
+{
+    ast_cursor cursor(e, cur_access, last_child);
+    while (!cursor.done())
+        cursor.advance(cb(functor, cursor.entity(), cursor.info()));
+    return !cursor.aborted();
 }
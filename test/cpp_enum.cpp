@@ -174,3 +174,19 @@ enum ns::c : int {};
     });
     REQUIRE(count == 5u);
 }
+
+TEST_CASE("cpp_enum many values")
+{
+    // destroying it must not recurse for every value
+    cpp_entity_index  idx;
+    cpp_enum::builder builder("e", true, cpp_builtin_type::build(cpp_int), false);
+    for (auto i = 0; i != 200000; ++i)
+        builder.add_value(cpp_enum_value::build(idx, cpp_entity_id("e::v" + std::to_string(i)),
+                                                "v" + std::to_string(i)));
+    auto e = builder.finish(idx, cpp_entity_id("e"), type_safe::nullopt);
+
+    REQUIRE(e->size() == 200000u);
+    REQUIRE(e->begin()[1234].name() == "v1234");
+    REQUIRE((e->end() - 1)->name() == "v199999");
+    REQUIRE(&e->begin()[42].parent().value() == e.get());
+}
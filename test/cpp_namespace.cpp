@@ -98,6 +98,35 @@ namespace e::f {}
     REQUIRE(count == 7u);
 }
 
+TEST_CASE("cpp_namespace lookup")
+{
+    cpp_entity_index                            idx;
+    std::vector<std::unique_ptr<cpp_namespace>> namespaces;
+
+    auto id = cpp_entity_id("ns");
+    REQUIRE(idx.lookup_namespace(id).size() == 0u);
+
+    namespaces.push_back(cpp_namespace::builder("ns", false, false).finish(idx, id));
+    auto first = idx.lookup_namespace(id);
+    REQUIRE(first.size() == 1u);
+
+    // references must stay valid while new namespaces are registered
+    for (auto i = 0; i != 100; ++i)
+        namespaces.push_back(cpp_namespace::builder("ns", false, false).finish(idx, id));
+    REQUIRE(first.size() == 1u);
+    REQUIRE(&first[0u].get() == namespaces.front().get());
+
+    auto all = idx.lookup_namespace(id);
+    REQUIRE(all.size() == namespaces.size());
+    for (auto i = 0u; i != all.size(); ++i)
+        REQUIRE(&all[i].get() == namespaces[i].get());
+
+    idx.freeze();
+    REQUIRE(&first[0u].get() == namespaces.front().get());
+    REQUIRE(idx.lookup_namespace(id).size() == namespaces.size());
+    REQUIRE(idx.lookup_namespace(cpp_entity_id("other")).size() == 0u);
+}
+
 TEST_CASE("cpp_namespace_alias")
 {
     auto code = R"(
@@ -15,7 +15,7 @@ void check_equal_tokens(const std::string& str, std::initializer_list<cpp_token>
 {
     auto token_str = cpp_token_string::tokenize(str);
     INFO(str);
-    REQUIRE(token_str.end() - token_str.begin() == tokens.size());
+    REQUIRE(token_str.size() == tokens.size());
     REQUIRE(std::equal(token_str.begin(), token_str.end(), tokens.begin()));
 }
 
@@ -127,3 +127,62 @@ TEST_CASE("tokenizer")
                                              cpp_token(cpp_token_kind::punctuation, ">")});
     }
 }
+
+TEST_CASE("cpp_string")
+{
+    cpp_string empty;
+    REQUIRE(empty.empty());
+    REQUIRE(empty == cpp_string(""));
+
+    cpp_string a("size_t");
+    REQUIRE(a.str() == "size_t");
+    REQUIRE(a == "size_t");
+    REQUIRE(a == std::string("size_t"));
+    REQUIRE(a != "size");
+
+    // equal strings share the storage
+    cpp_string b(std::string("size") + "_t");
+    REQUIRE(a == b);
+    REQUIRE(&a.str() == &b.str());
+    REQUIRE(std::hash<cpp_string>()(a) == std::hash<cpp_string>()(b));
+    REQUIRE(a != cpp_string("std"));
+
+    auto tokens = cpp_token_string::tokenize("std::size_t");
+    REQUIRE(std::next(tokens.begin(), 2)->spelling == a);
+}
+
+TEST_CASE("cpp_token_string")
+{
+    auto str = cpp_token_string::tokenize("unsigned long x = sizeof(int) >> 2");
+    REQUIRE(str.size() == 10u);
+    REQUIRE(str.end() - str.begin() == 10);
+    REQUIRE(str.front() == cpp_token(cpp_token_kind::keyword, "unsigned"));
+    REQUIRE(str.front().kind == cpp_token_kind::keyword);
+    REQUIRE(str.back().kind == cpp_token_kind::int_literal);
+    REQUIRE(str.begin()[2].kind == cpp_token_kind::identifier);
+    REQUIRE((str.end() - 2)->spelling == ">>");
+    REQUIRE(str.as_string() == "unsigned long x=sizeof(int)>>2");
+
+    std::string spellings;
+    for (auto& token : str)
+        spellings += token.spelling.c_str();
+    REQUIRE(spellings == "unsignedlongx=sizeof(int)>>2");
+
+    REQUIRE(str == cpp_token_string::tokenize("unsigned long x=sizeof(int)>>2"));
+    REQUIRE(str != cpp_token_string::tokenize("unsigned long x = sizeof(int) >> 3"));
+    REQUIRE(str != cpp_token_string::tokenize("unsigned long x"));
+
+    cpp_token_string::builder builder;
+    builder.add_token(cpp_token(cpp_token_kind::identifier, "a"));
+    builder.add_token(cpp_token(cpp_token_kind::punctuation, ">>"));
+    builder.unmunch();
+    auto unmunched = builder.finish();
+    REQUIRE(unmunched.size() == 2u);
+    REQUIRE(unmunched.back() == cpp_token(cpp_token_kind::punctuation, ">"));
+    REQUIRE(unmunched.as_string() == "a>");
+
+    cpp_token_string empty(std::vector<cpp_token>{});
+    REQUIRE(empty.empty());
+    REQUIRE(empty.begin() == empty.end());
+    REQUIRE(empty.as_string().empty());
+}
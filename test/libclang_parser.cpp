@@ -4,9 +4,17 @@
 
 #include <catch2/catch.hpp>
 
+#include <cppast/cpp_function_type.hpp>
+#include <cppast/cpp_variable.hpp>
 #include <cppast/libclang_parser.hpp>
 
+#include <algorithm>
+#include <cstdio>
 #include <fstream>
+#include <thread>
+
+#include "libclang/toolchain_cache.hpp"
+#include "test_parser.hpp"
 
 using namespace cppast;
 
@@ -61,6 +69,11 @@ TEST_CASE("libclang_compile_config")
     "directory": "",
     "command": "/usr/bin/clang++ -std=c++14 -fms-extensions -fms-compatibility -fno-strict-aliasing -c -o c.o c.cpp",
     "file": "C:/c.cpp",
+},
+{
+    "directory": "C:/foo",
+    "command": "/usr/bin/clang++ -Irelative -IC:/absolute -DA=FOO -DB(X)=X -c -o d.o d.cpp",
+    "file": "d.cpp"
 }
 ])";
 
@@ -87,6 +100,11 @@ TEST_CASE("libclang_compile_config")
     "directory": "",
     "command": "/usr/bin/clang++ -std=c++14 -fms-extensions -fms-compatibility -fno-strict-aliasing -c -o c.o c.cpp",
     "file": "/c.cpp",
+},
+{
+    "directory": "/foo",
+    "command": "/usr/bin/clang++ -Irelative -I/absolute -DA=FOO -DB(X)=X -c -o d.o d.cpp",
+    "file": "d.cpp"
 }
 ])";
 
@@ -106,4 +124,296 @@ TEST_CASE("libclang_compile_config")
 
     libclang_compile_config c(database, CPPAST_DETAIL_DRIVE "/c.cpp");
     require_flags(c, "-std=c++14 -fms-extensions -fms-compatibility -fno-strict-aliasing");
+
+    // a.cpp and d.cpp share the configuration
+    REQUIRE(database.no_files() == 4u);
+    REQUIRE(database.no_configurations() == 3u);
+
+    REQUIRE(database.has_config(CPPAST_DETAIL_DRIVE "/foo/a.cpp"));
+    REQUIRE(database.has_config(CPPAST_DETAIL_DRIVE "/foo/../foo/./a.cpp"));
+    REQUIRE(!database.has_config(CPPAST_DETAIL_DRIVE "/foo/a.hpp"));
+
+    auto header = find_config_for(database, CPPAST_DETAIL_DRIVE "/foo/a.hpp");
+    REQUIRE(header);
+    require_flags(header.value(), "-I" CPPAST_DETAIL_DRIVE "/foo/relative -I" CPPAST_DETAIL_DRIVE
+                                  "/absolute -DA=FOO -DB(X)=X");
+    REQUIRE(!find_config_for(database, CPPAST_DETAIL_DRIVE "/foo/e.hpp"));
+}
+
+TEST_CASE("libclang_parser concurrent parsing")
+{
+    std::vector<std::string> file_names;
+    for (auto i = 0; i != 8; ++i)
+    {
+        auto name = "libclang_parser_" + std::to_string(i) + ".cpp";
+        write_file(name.c_str(), ("struct s" + std::to_string(i) + " {};").c_str());
+        file_names.push_back(std::move(name));
+    }
+
+    cpp_entity_index                      idx;
+    parallel_file_parser<libclang_parser> parser(type_safe::ref(idx), worker_count(4u),
+                                                 default_logger());
+    parse_files(parser, file_names, make_test_config());
+
+    auto i = 0;
+    for (auto& file : parser.files())
+    {
+        REQUIRE(file.name() == file_names[std::size_t(i)]);
+        REQUIRE(count_children(file) == 1u);
+        REQUIRE(file.begin()->name() == "s" + std::to_string(i));
+        ++i;
+    }
+    REQUIRE(i == 8);
+    REQUIRE(!parser.error());
+}
+
+TEST_CASE("libclang_compile_config toolchain cache")
+{
+    auto cache_file = "cppast_toolchain_cache.txt";
+    libclang_compile_config::set_toolchain_cache_file(cache_file);
+
+    auto no_probes = detail::toolchain_probe_count();
+    libclang_compile_config a;
+    REQUIRE(std::ifstream(cache_file).peek() != EOF);
+    // at most one probe, if no previous configuration has used the binary already
+    auto no_probes_a = detail::toolchain_probe_count();
+    REQUIRE(no_probes_a <= no_probes + 1u);
+
+    // cache hit: the binary isn't invoked again
+    libclang_compile_config b;
+    REQUIRE(detail::toolchain_probe_count() == no_probes_a);
+    REQUIRE(detail::libclang_compile_config_access::flags(a)
+            == detail::libclang_compile_config_access::flags(b));
+
+    // add an include directory to every binary in the file,
+    // so we can check that the persisted information is used
+    std::string content;
+    {
+        std::ifstream file(cache_file);
+        std::string   line;
+        while (std::getline(file, line))
+        {
+            // <binary>\t<mtime>\t<size>\t<valid>\t<no dirs>
+            auto tab = line.rfind('\t');
+            if (tab == std::string::npos)
+                content += line + "\n";
+            else
+                content += line.substr(0, tab + 1u)
+                           + std::to_string(std::stoul(line.substr(tab + 1u)) + 1u)
+                           + "\ncppast_toolchain_cache_dir\n";
+        }
+    }
+    std::ofstream(cache_file) << content;
+
+    // load it again
+    detail::clear_toolchain_cache();
+    libclang_compile_config c;
+    REQUIRE(detail::toolchain_probe_count() == no_probes_a);
+    auto& flags = detail::libclang_compile_config_access::flags(c);
+    REQUIRE(std::find(flags.begin(), flags.end(), "-Icppast_toolchain_cache_dir") != flags.end());
+
+    libclang_compile_config::set_toolchain_cache_file("");
+    detail::clear_toolchain_cache();
+    std::remove(cache_file);
+}
+
+TEST_CASE("libclang_parser reparse")
+{
+    auto file_name = "libclang_parser_reparse.cpp";
+    write_file(file_name, "#include <cstddef>\nstruct a {};\n");
+
+    libclang_parser p(default_logger());
+    p.retain_translation_units(std::size_t(1u) << 30u);
+
+    cpp_entity_index first_idx;
+    auto             first = p.parse(first_idx, file_name, make_test_config());
+    REQUIRE(first);
+    REQUIRE(count_children(*first) == 2u);
+
+    cpp_entity_index second_idx;
+    auto second = p.reparse(second_idx, file_name, "#include <cstddef>\nstruct b {};\nint c;\n");
+    REQUIRE(second);
+    REQUIRE(second->name() == first->name());
+    REQUIRE(count_children(*second) == 3u);
+    REQUIRE(std::next(second->begin())->name() == "b");
+    REQUIRE(!p.error());
+
+    // concurrent reparses of the same file wait for each other
+    cpp_entity_index          concurrent_idx[4];
+    std::unique_ptr<cpp_file> concurrent[4];
+    std::vector<std::thread>  threads;
+    for (auto i = 0u; i != 4u; ++i)
+        threads.emplace_back([&, i] {
+            concurrent[i] = p.reparse(concurrent_idx[i], file_name, "struct d {};\n");
+        });
+    for (auto& thread : threads)
+        thread.join();
+    for (auto& file : concurrent)
+    {
+        REQUIRE(file);
+        REQUIRE(count_children(*file) == 1u);
+    }
+    REQUIRE(!p.error());
+
+    p.retain_translation_units(0u);
+    cpp_entity_index third_idx;
+    REQUIRE_THROWS_AS(p.reparse(third_idx, file_name, ""), libclang_error);
+}
+
+TEST_CASE("libclang_parser skip function bodies")
+{
+    auto file_name = "libclang_parser_skip_function_bodies.cpp";
+    write_file(file_name, R"(
+#include <stdexcept>
+
+int a(int i) { return i + 1; }
+constexpr int b(int i) { return i * 2; }
+auto c(int i) { return i; }
+auto d(int i) -> decltype(i) { if (i) { return 0; } return i; }
+void e() noexcept(true) try { throw 0; } catch (int) {} catch (...) { throw; }
+void f() = delete;
+
+template <typename T>
+T g(T t = T{}) { return t; }
+
+struct h
+{
+    int m;
+
+    h() : m{0} {}
+    h(int i) try : m(i) { throw std::runtime_error("h"); } catch (...) {}
+    h(const h&) = default;
+    ~h() noexcept {}
+
+    int n() const & { return m; }
+    virtual void o();
+    explicit operator bool() const { return m != 0; }
+    h& operator=(const h& other) { m = other.m; return *this; }
+};
+
+void h::o() {}
+)");
+
+    auto parse_with = [&](bool skip_function_bodies) {
+        auto config = make_test_config();
+        config.skip_function_bodies(skip_function_bodies);
+
+        cpp_entity_index idx;
+        libclang_parser  p(default_logger());
+        auto             file = p.parse(idx, file_name, config);
+        REQUIRE(file);
+        REQUIRE(!p.error());
+        return get_code(*file);
+    };
+
+    auto with_bodies = parse_with(false);
+    REQUIRE(!with_bodies.empty());
+    REQUIRE(parse_with(true) == with_bodies);
+}
+
+TEST_CASE("libclang_parser arena allocation")
+{
+    auto file_name = "libclang_parser_arena_allocation.cpp";
+    write_file(file_name, R"(
+#define A 42
+
+namespace ns
+{
+    template <typename T, int I = A>
+    struct a
+    {
+        T   member[I];
+        int function(const T& t, int (*fnc)(T)) const;
+    };
+
+    using b = a<decltype(sizeof(int)), 4>;
+}
+
+enum class c : unsigned
+{
+    d = 1 << 3,
+    e = static_cast<unsigned>(d) + 1,
+};
+)");
+
+    auto parse_with = [&](bool use_arena) {
+        cpp_entity_index idx;
+        libclang_parser  p(default_logger());
+        p.set_arena_allocation(use_arena);
+        auto file = p.parse(idx, file_name, make_test_config());
+        REQUIRE(file);
+        REQUIRE(!p.error());
+
+        // the arena is only created and used if arena allocation is enabled
+        auto arena = detail::cpp_file_access::get_arena(*file);
+        REQUIRE((arena != nullptr) == use_arena);
+        if (arena)
+        {
+            REQUIRE(arena->no_allocations() > 0u);
+            REQUIRE(arena->capacity() > 0u);
+        }
+
+        return get_code(*file);
+    };
+
+    auto on_heap = parse_with(false);
+    REQUIRE(!on_heap.empty());
+    REQUIRE(parse_with(true) == on_heap);
+}
+
+TEST_CASE("libclang_parser type sharing")
+{
+    auto file_name = "libclang_parser_type_sharing.cpp";
+    write_file(file_name, R"(
+struct a {};
+
+const char* b;
+const char* c;
+const a& d = a();
+const a& e = a();
+int (*f)(const char*, int);
+)");
+
+    auto parse_with = [&](bool share_types) {
+        cpp_entity_index idx;
+        libclang_parser  p(default_logger());
+        p.set_type_sharing(share_types);
+        auto file = p.parse(idx, file_name, make_test_config());
+        REQUIRE(file);
+        REQUIRE(!p.error());
+        return file;
+    };
+
+    auto not_shared = parse_with(false);
+    auto shared     = parse_with(true);
+    REQUIRE(get_code(*shared) == get_code(*not_shared));
+
+    std::vector<const cpp_type*> types;
+    test_visit<cpp_variable>(*shared,
+                             [&](const cpp_variable& var) {
+                                 types.push_back(&var.type());
+                                 return false;
+                             },
+                             false);
+    REQUIRE(types.size() == 5u);
+
+    // the variables own their type, but the subtypes are shared
+    for (auto type : types)
+        REQUIRE(!type->is_shared());
+
+    auto& b = static_cast<const cpp_pointer_type&>(*types[0]);
+    auto& c = static_cast<const cpp_pointer_type&>(*types[1]);
+    REQUIRE(b.pointee().is_shared());
+    REQUIRE(&b.pointee() == &c.pointee());
+
+    auto& d = static_cast<const cpp_reference_type&>(*types[2]);
+    auto& e = static_cast<const cpp_reference_type&>(*types[3]);
+    REQUIRE(&d.referee() == &e.referee());
+
+    auto& f     = static_cast<const cpp_pointer_type&>(*types[4]);
+    auto& f_sig = static_cast<const cpp_function_type&>(f.pointee());
+    REQUIRE(!f_sig.is_shared());
+    REQUIRE(f_sig.return_type().is_shared());
+    auto& f_param = static_cast<const cpp_pointer_type&>(*f_sig.parameter_types().begin());
+    REQUIRE(&f_param.pointee() == &b.pointee());
 }
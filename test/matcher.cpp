@@ -0,0 +1,113 @@
+// Copyright (C) 2017-2019 Jonathan Müller <jonathanmueller.dev@gmail.com>
+// This file is subject to the license terms in the LICENSE file
+// found in the top-level directory of this distribution.
+
+#include <cppast/matcher.hpp>
+
+#include "test_parser.hpp"
+
+using namespace cppast;
+
+TEST_CASE("matcher")
+{
+    auto code = R"(
+        namespace ns
+        {
+            struct a
+            {
+                int i;
+                const int* j;
+
+                [[deprecated]] int& f(int k);
+            };
+
+            using b = const char;
+        }
+
+        [[nodiscard]] int g(const ns::a& l);
+        float m;
+    )";
+
+    cpp_entity_index idx;
+    auto             file = parse(idx, "matcher.cpp", code);
+
+    using namespace matchers;
+
+    SECTION("matches")
+    {
+        auto matcher = all_of(is_kind(cpp_entity_kind::class_t), has_name("a"),
+                              has_parent(is_kind(cpp_entity_kind::namespace_t)));
+
+        auto count = 0u;
+        cppast::visit(*file, [&](const cpp_entity& e, const visitor_info& info) {
+            if (info.is_new_entity() && matcher.matches(e))
+            {
+                REQUIRE(e.name() == "a");
+                ++count;
+            }
+        });
+        REQUIRE(count == 1u);
+    }
+    SECTION("match_finder")
+    {
+        std::string  result;
+        match_finder finder;
+        auto         record = [&](const char* name) {
+            return [&result, name](const match_result& match) {
+                result += std::string(name) + ": " + match.entity().name() + "\n";
+            };
+        };
+
+        finder.add(is_kind(cpp_entity_kind::member_variable_t), record("member"));
+        finder.add(has_type(is_builtin(cpp_int)), record("int"));
+        finder.add(has_type(points_to(is_const())), record("pointer to const"));
+        finder.add(has_type(references(any_type())), record("reference"));
+        finder.add(has_type(all_of(is_const(), ignoring_cv(is_builtin(cpp_char)))),
+                   record("const char"));
+        finder.add(has_attribute(cpp_attribute_kind::deprecated), record("deprecated"));
+        finder.add(has_attribute("nodiscard"), record("nodiscard"));
+        finder.add(all_of(is_kind(cpp_entity_kind::member_function_t),
+                          has_ancestor(is_kind(cpp_entity_kind::namespace_t))),
+                   record("member function"));
+        finder.add(all_of(is_kind(cpp_entity_kind::variable_t),
+                          unless(has_ancestor(is_kind(cpp_entity_kind::namespace_t)))),
+                   record("global variable"));
+        finder.add(any_of(has_name("b"), has_name("m")), record("b or m"));
+        REQUIRE(finder.size() == 10u);
+
+        finder.match(*file);
+        REQUIRE(result == R"(member: i
+int: i
+member: j
+pointer to const: j
+reference: f
+deprecated: f
+member function: f
+const char: b
+b or m: b
+int: g
+nodiscard: g
+global variable: m
+b or m: m
+)");
+    }
+    SECTION("bindings")
+    {
+        auto matcher = all_of(is_kind(cpp_entity_kind::member_variable_t), has_name("j"),
+                              has_ancestor(is_kind(cpp_entity_kind::namespace_t).bind("namespace")),
+                              has_parent(any_entity().bind("class")))
+                           .bind("member");
+
+        auto         count = 0u;
+        match_finder finder;
+        finder.add(matcher, [&](const match_result& match) {
+            REQUIRE(&match.get("member").value() == &match.entity());
+            REQUIRE(match.get("class").value().name() == "a");
+            REQUIRE(match.get("namespace").value().name() == "ns");
+            REQUIRE(!match.get("function"));
+            ++count;
+        });
+        finder.match(*file);
+        REQUIRE(count == 1u);
+    }
+}
@@ -6,6 +6,8 @@
 
 #include <catch2/catch.hpp>
 
+#include <iterator>
+
 using namespace cppast;
 
 TEST_CASE("parse_files")
@@ -47,13 +49,55 @@ TEST_CASE("parse_files")
         stderr_diagnostic_logger logger_;
     };
 
-    cpp_entity_index                idx;
-    simple_file_parser<null_parser> parser(type_safe::ref(idx));
+    SECTION("simple_file_parser")
+    {
+        cpp_entity_index                idx;
+        simple_file_parser<null_parser> parser(type_safe::ref(idx));
+
+        auto file_names = {"a.cpp", "b.cpp", "c.cpp"};
+        parse_files(parser, file_names, config);
 
-    auto file_names = {"a.cpp", "b.cpp", "c.cpp"};
-    parse_files(parser, file_names, config);
+        auto iter = file_names.begin();
+        for (auto& file : parser.files())
+            REQUIRE(file.name() == *iter++);
 
-    auto iter = file_names.begin();
-    for (auto& file : parser.files())
-        REQUIRE(file.name() == *iter++);
+        // parsing a file doesn't invalidate the iteration
+        std::string names;
+        for (auto& file : parser.files())
+        {
+            if (file.name() == "a.cpp")
+                parser.parse("d.cpp", config);
+            names += file.name() + ";";
+        }
+        REQUIRE(names == "a.cpp;b.cpp;c.cpp;d.cpp;");
+    }
+    SECTION("parallel_file_parser")
+    {
+        cpp_entity_index                  idx;
+        parallel_file_parser<null_parser> parser(type_safe::ref(idx), worker_count(4u));
+        REQUIRE(parser.no_workers() == 4u);
+
+        std::vector<std::string> file_names;
+        for (auto i = 0; i != 100; ++i)
+            file_names.push_back(std::to_string(i) + ".cpp");
+        parse_files(parser, file_names, config);
+
+        auto iter = file_names.begin();
+        for (auto& file : parser.files())
+            REQUIRE(file.name() == *iter++);
+        REQUIRE(iter == file_names.end());
+        REQUIRE(!parser.error());
+        REQUIRE(std::distance(parser.files().begin(), parser.files().end()) == 100);
+
+        idx.freeze();
+        REQUIRE(idx.is_frozen());
+        for (auto& file : parser.files())
+        {
+            auto entity = idx.lookup_definition(cpp_entity_id(file.name()));
+            REQUIRE(entity);
+            REQUIRE(&entity.value() == &file);
+        }
+        REQUIRE(!idx.lookup(cpp_entity_id("foo.cpp")));
+        REQUIRE_THROWS_AS(cpp_file::builder("foo.cpp").finish(idx), cpp_entity_index::frozen_error);
+    }
 }
@@ -1,7 +1,9 @@
 #include <catch2/catch.hpp>
+#include <algorithm>
 #include <fstream>
 
 #include "libclang/preprocessor.hpp"
+#include "libclang/scanner.hpp"
 #include "test_parser.hpp"
 
 #include <cppast/cpp_variable.hpp>
@@ -307,3 +309,104 @@ void j();
     }
     REQUIRE((file->unmatched_comments().size() == 3u + add));
 }
+
+namespace
+{
+std::string describe_preprocessor_entities(const cpp_file& file)
+{
+    std::string result;
+    for (auto& e : file)
+    {
+        if (e.kind() == cpp_entity_kind::macro_definition_t)
+        {
+            auto& macro = static_cast<const cpp_macro_definition&>(e);
+            result += "macro " + macro.name() + (macro.is_function_like() ? "()" : "") + " "
+                      + macro.replacement();
+        }
+        else if (e.kind() == cpp_entity_kind::include_directive_t)
+        {
+            auto& include = static_cast<const cpp_include_directive&>(e);
+            result += "include " + include.name() + " " + include.full_path()
+                      + (include.include_kind() == cpp_include_kind::system ? " <>" : " \"\"");
+        }
+        else
+            result += e.name();
+
+        if (e.comment())
+            result += " // " + e.comment().value();
+        result += "\n";
+    }
+
+    for (auto& comment : file.unmatched_comments())
+        result += std::to_string(comment.line) + ": " + comment.content + "\n";
+
+    return result;
+}
+} // namespace
+
+TEST_CASE("in-process preprocessing")
+{
+    write_file("in_process_preprocessing.hpp", "");
+    write_file("in_process_preprocessing.cpp", R"(
+#include <cstddef>
+#include "in_process_preprocessing.hpp"
+
+/// a
+/// a
+#define a(x, y) \
+    x + y
+
+#define b 42 /* b */
+#undef b
+
+#if 0
+#define c
+/// c
+#endif
+
+/// d
+struct d {};
+
+/// unmatched
+)");
+
+    auto parse_file = [](bool in_process) {
+        auto config = make_test_config();
+        config.in_process_preprocessing(in_process);
+
+        cpp_entity_index idx;
+        libclang_parser  p(default_logger());
+
+        std::unique_ptr<cpp_file> result;
+        REQUIRE_NOTHROW(result = p.parse(idx, "in_process_preprocessing.cpp", config));
+        REQUIRE(!p.error());
+        return result;
+    };
+
+    auto external   = parse_file(false);
+    auto in_process = parse_file(true);
+    REQUIRE(describe_preprocessor_entities(*in_process)
+            == describe_preprocessor_entities(*external));
+    REQUIRE(count_children(*in_process) == 4u);
+}
+
+TEST_CASE("preprocessor scanner")
+{
+    // cover every position relative to the 16 byte blocks
+    for (auto length = 0u; length != 40u; ++length)
+        for (auto pos = 0u; pos <= length; ++pos)
+        {
+            std::string str(length, 'a');
+            if (pos != length)
+                str[pos] = '#';
+            for (auto i = pos + 3u; i < length; i += 5u)
+                str[i] = '\n';
+
+            auto begin = str.data();
+            auto end   = str.data() + str.size();
+            REQUIRE(detail::find_first_of<'#', '/'>(begin, end) == begin + pos);
+            REQUIRE(detail::find_first_of<'/'>(begin, end) == end);
+            REQUIRE(detail::count_newlines(begin, end)
+                    == std::size_t(std::count(begin, end, '\n')));
+        }
+}
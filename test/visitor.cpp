@@ -1,7 +1,12 @@
 #include <cppast/cpp_entity.hpp>
+#include <cppast/cpp_enum.hpp>
+#include <cppast/cpp_namespace.hpp>
+#include <cppast/parallel_visitor.hpp>
 using namespace cppast;
 
 #include "test_parser.hpp"
+#include <algorithm>
+#include <atomic>
 #include <iostream>
 
 TEST_CASE("visitor_filtered")
@@ -104,3 +109,288 @@ TEST_CASE("visitor_filtered")
         }
     }
 }
+
+TEST_CASE("static_visit")
+{
+    auto code = R"(
+        namespace ns
+        {
+            enum e
+            {
+                a,
+                b,
+            };
+        }
+
+        class c {};
+    )";
+
+    cpp_entity_index idx;
+    auto             file = parse(idx, "static_visit.cpp", code);
+
+    std::string result;
+    cppast::visit(*file, [&](const cpp_entity& e, cppast::visitor_info info) {
+        if (info.is_old_entity())
+            return;
+
+        result += static_visit<cpp_enum, cpp_enum_value, cpp_class>(
+            e, overload([](const cpp_enum& en) { return "enum " + en.name() + ";"; },
+                        [](const cpp_enum_value& value) { return "value " + value.name() + ";"; },
+                        [](const cpp_class& c) { return "class " + c.name() + ";"; },
+                        [](const cpp_entity& other) {
+                            return std::string(to_string(other.kind())) + ";";
+                        }));
+    });
+    REQUIRE(result == "file;namespace;enum e;value a;value b;class c;");
+}
+
+TEST_CASE("for_each_of_kind")
+{
+    auto code = R"(
+        namespace ns
+        {
+            enum e
+            {
+                a,
+                b,
+            };
+
+            class c {};
+        }
+
+        enum class f {};
+
+        struct g
+        {
+            enum h {};
+        };
+    )";
+
+    cpp_entity_index idx;
+    auto             file = parse(idx, "for_each_of_kind.cpp", code);
+
+    std::string result;
+    auto        record = [&](const cpp_entity& e) {
+        REQUIRE(e.parent());
+        result += e.name() + ";";
+    };
+    for_each_of_kind<cpp_entity_kind::enum_t, cpp_entity_kind::class_t>(*file, record);
+    REQUIRE(result == "e;c;f;g;h;");
+
+    auto count = 0u;
+    for_each_of_kind<cpp_entity_kind::enum_value_t>(*file, [&](const cpp_entity& e) {
+        REQUIRE(e.parent().value().name() == "e");
+        ++count;
+    });
+    REQUIRE(count == 2u);
+}
+
+TEST_CASE("parallel_visit")
+{
+    auto code_a = R"(
+        namespace ns
+        {
+            enum e
+            {
+                a,
+                b,
+            };
+
+            void f();
+        }
+
+        extern "C"
+        {
+            void g();
+        }
+    )";
+    auto code_b = R"(
+        enum class h
+        {
+            c,
+        };
+
+        namespace ns
+        {
+            void i();
+        }
+    )";
+
+    cpp_entity_index                       idx;
+    std::vector<std::unique_ptr<cpp_file>> files;
+    files.push_back(parse(idx, "parallel_visit_a.cpp", code_a));
+    files.push_back(parse(idx, "parallel_visit_b.cpp", code_b));
+
+    auto is_match = [](const cpp_entity& e, const visitor_info& info) {
+        return info.is_new_entity()
+               && (e.kind() == cpp_entity_kind::enum_value_t
+                   || e.kind() == cpp_entity_kind::function_t);
+    };
+
+    for (auto split : {false, true})
+    {
+        parallel_visit_options options;
+        options.workers          = worker_count(2u);
+        options.split_namespaces = split;
+
+        std::atomic<unsigned> count(0u);
+        parallel_visit(files,
+                       [&](const cpp_entity& e, const visitor_info& info) {
+                           if (is_match(e, info))
+                               ++count;
+                       },
+                       options);
+        REQUIRE(count == 6u);
+
+        auto result = parallel_visit_reduce(
+            files, 0u,
+            [&](unsigned& local, const cpp_entity& e, const visitor_info& info) {
+                if (is_match(e, info))
+                    ++local;
+            },
+            [](unsigned lhs, unsigned rhs) { return lhs + rhs; }, options);
+        REQUIRE(result == 6u);
+    }
+}
+
+TEST_CASE("ast_cursor")
+{
+    auto code = R"(
+        namespace ns
+        {
+            enum e
+            {
+                a,
+                b,
+            };
+
+            class c
+            {
+                int d;
+            public:
+                void f();
+            };
+
+            enum skipped
+            {
+                x,
+            };
+        }
+
+        void g();
+    )";
+
+    cpp_entity_index idx;
+    auto             file = parse(idx, "ast_cursor.cpp", code);
+
+    auto get_event = [](const cpp_entity& e, const visitor_info& info) {
+        auto result = std::string(to_string(e.kind()));
+        if (e.kind() != cpp_entity_kind::file_t)
+            result += " " + e.name();
+        if (info.event == visitor_info::container_entity_enter)
+            result += " enter";
+        else if (info.event == visitor_info::container_entity_exit)
+            result += " exit";
+        if (info.access == cpp_private)
+            result += " private";
+        if (info.last_child)
+            result += " last";
+        return result + "\n";
+    };
+
+    // the children of skipped are not visited
+    std::string result;
+    auto        handle = [&](const cpp_entity& e, const visitor_info& info) {
+        result += get_event(e, info);
+        return info.event != visitor_info::container_entity_enter || e.name() != "skipped";
+    };
+    auto expected = R"(file enter
+namespace ns enter
+enum e enter
+enum value a
+enum value b last
+enum e exit
+class c enter
+member variable d private
+access specifier public
+member function f last
+class c exit
+enum skipped enter last
+enum skipped exit last
+namespace ns exit
+function g last
+file exit
+)";
+
+    SECTION("visit")
+    {
+        cppast::visit(*file, handle);
+        REQUIRE(result == expected);
+    }
+    SECTION("events")
+    {
+        ast_cursor cursor(*file);
+        while (!cursor.done())
+            cursor.advance(handle(cursor.entity(), cursor.info()));
+        REQUIRE(result == expected);
+        REQUIRE(!cursor.aborted());
+    }
+    SECTION("skip children")
+    {
+        std::string names;
+        for (ast_cursor cursor(*file); !cursor.done();)
+        {
+            if (cursor.entity().kind() != cpp_entity_kind::file_t)
+                names += cursor.entity().name() + ";";
+            if (cursor.entity().kind() == cpp_entity_kind::class_t)
+                cursor.skip_children();
+            else
+                cursor.next();
+        }
+        REQUIRE(names == "ns;e;a;b;e;c;c;skipped;x;skipped;ns;g;");
+    }
+    SECTION("abort")
+    {
+        std::string names;
+        ast_cursor  cursor(*file);
+        while (!cursor.done())
+        {
+            if (cursor.entity().kind() != cpp_entity_kind::file_t)
+                names += cursor.entity().name() + ";";
+            if (cursor.entity().kind() == cpp_entity_kind::enum_value_t)
+                cursor.abort();
+            else
+                cursor.next();
+        }
+        REQUIRE(names == "ns;e;a;");
+        REQUIRE(cursor.aborted());
+    }
+    SECTION("deep nesting")
+    {
+        // the cursor uses the same amount of call stack for every nesting level,
+        // but destroying the namespaces still recurses once per level,
+        // so the depth must be safe for that in debug and sanitizer builds
+        auto depth = 1000u;
+
+        std::unique_ptr<cpp_namespace> ns;
+        for (auto i = 0u; i != depth; ++i)
+        {
+            cpp_namespace::builder builder("n", false, false);
+            if (ns)
+                builder.add_child(std::move(ns));
+            ns = builder.finish(idx, cpp_entity_id("ast_cursor_" + std::to_string(i)));
+        }
+
+        auto       no_events = 0u;
+        auto       max_depth = std::size_t(0u);
+        ast_cursor cursor(*ns);
+        for (; !cursor.done(); cursor.next())
+        {
+            ++no_events;
+            max_depth = std::max(max_depth, cursor.depth());
+        }
+        REQUIRE(!cursor.aborted());
+        REQUIRE(no_events == 2u * depth);
+        REQUIRE(max_depth == depth - 1u);
+    }
+}